@@ -0,0 +1,72 @@
+// g++ bench_format.cpp -std=c++17 -O2 -o bench_format
+#include "format_fd.h"
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+template <typename F>
+double time_ms(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template <typename T>
+void bench(const char* name, const T& value)
+{
+    std::ostringstream old_os;
+    double old_ms = time_ms([&] { old_os << value; });
+
+    std::ostringstream new_os;
+    double new_ms = time_ms([&] { format_write(new_os, value); });
+
+    int fd = open("/dev/null", O_WRONLY);
+    double fd_ms = time_ms([&] { format_write(fd, value); });
+    close(fd);
+
+    format_limits limits;
+    limits.max_elements = 16;
+    std::ostringstream short_os;
+    double short_ms = time_ms([&] { format_write(short_os, value, limits); });
+
+    std::cout << name << ": bytes=" << old_os.str().size()
+              << " operator<<=" << old_ms << "ms"
+              << " format_write(ostream)=" << new_ms << "ms"
+              << " format_write(fd)=" << fd_ms << "ms"
+              << " max_elements=16: " << short_ms << "ms"
+              << " same=" << (old_os.str() == new_os.str()) << std::endl;
+}
+
+int main()
+{
+    std::vector<int> ints;
+    for (int i = 0; i < 2000000; i++) {
+        ints.push_back((int)((unsigned)i * 7919u));
+    }
+    bench("vector<int>", ints);
+
+    std::map<int, std::vector<int>> nested;
+    for (int i = 0; i < 100000; i++) {
+        nested[i] = std::vector<int>(10, i);
+    }
+    bench("map<int, vector<int>>", nested);
+
+    std::map<std::string, std::pair<long, std::string>> records;
+    for (int i = 0; i < 200000; i++) {
+        records["key" + std::to_string(i)] = std::make_pair((long)i * 1000003, "value" + std::to_string(i));
+    }
+    bench("map<string, pair<long, string>>", records);
+
+    format_limits limits;
+    limits.max_elements = 3;
+    limits.max_bytes = 60;
+    format_write(std::cout, std::make_tuple(1, std::string("two"), 3.5, ints), limits);
+    std::cout << std::endl;
+    return 0;
+}
@@ -0,0 +1,280 @@
+#ifndef BINARY_SERIALIZE_H
+#define BINARY_SERIALIZE_H
+
+// 基于template.h里的类型萃取，把任意STL容器/pair/tuple/算术类型按二进制写出和读回
+// 和operator<<一样靠编译期分派，不需要给每种类型写序列化代码：
+//   std::string data = binary_dump(state);
+//   binary_load(data, state);
+// 格式(按主机字节序，只用于同一种机器上的检查点)：
+//   bool：一个字节，读的时候非0即true
+//   算术类型和枚举：原始字节
+//   pair/tuple：依次写每个成员
+//   容器：varint元素个数 + 元素；元素可平凡拷贝的连续容器(vector/string/array)整块memcpy
+
+#include <cstdint>      // uint64_t
+#include <cstring>      // std::memcpy
+#include <fstream>      // std::ifstream/ofstream
+#include <iterator>     // std::istreambuf_iterator
+#include <stdexcept>    // std::logic_error
+#include <string>       // std::string
+#include <tuple>        // std::apply
+#include <type_traits>  // std::is_trivially_copyable_v
+#include <utility>      // std::declval/pair
+
+#include "template.h"   // is_pair/is_tuple/is_container
+
+// Type trait to detect contiguous containers (data() + size())
+template <typename T, typename = void>
+struct is_contiguous : std::false_type {};
+template <typename T>
+struct is_contiguous<T, std::void_t<decltype(std::declval<T&>().data(),
+                                             std::declval<T&>().size())>>
+    : std::true_type {};
+
+// Type trait to detect resizable containers (vector/string)
+template <typename T, typename = void>
+struct has_resize : std::false_type {};
+template <typename T>
+struct has_resize<T, std::void_t<decltype(std::declval<T&>().resize(0))>>
+    : std::true_type {};
+
+// 没有clear()的容器(std::array)大小固定，按原位读每个元素
+template <typename T, typename = void>
+struct has_clear : std::false_type {};
+template <typename T>
+struct has_clear<T, std::void_t<decltype(std::declval<T&>().clear())>>
+    : std::true_type {};
+
+template <typename T, typename = void>
+struct has_reserve : std::false_type {};
+template <typename T>
+struct has_reserve<T, std::void_t<decltype(std::declval<T&>().reserve(0))>>
+    : std::true_type {};
+
+// map的value_type是pair<const K, V>，读的时候先读到pair<K, V>里
+template <typename T>
+struct readable { using type = T; };
+template <typename K, typename V>
+struct readable<std::pair<const K, V>> { using type = std::pair<K, V>; };
+
+// 元素可平凡拷贝的连续容器可以整块拷贝(vector<bool>没有data()，不算)
+// bool元素也不整块拷贝：读回来的字节不一定是0或1
+template <typename E>
+struct is_bulk_element
+    : std::bool_constant<std::is_trivially_copyable_v<E> && !std::is_same_v<std::remove_cv_t<E>, bool>> {};
+template <typename T, typename = void>
+struct is_bulk_copyable : std::false_type {};
+template <typename T>
+struct is_bulk_copyable<T, std::enable_if_t<is_container_v<T> && is_contiguous<T>::value>>
+    : is_bulk_element<std::remove_pointer_t<decltype(std::declval<T&>().data())>> {};
+template <typename T>
+inline constexpr bool is_bulk_copyable_v = is_bulk_copyable<T>::value;
+
+class binary_writer {
+public:
+    explicit binary_writer(std::string& out) : out_(out) {}
+
+    void write(const void* data, size_t size)
+    {
+        out_.append((const char*)data, size);
+    }
+
+    //每字节7位，最高位表示后面还有
+    void write_varint(uint64_t value)
+    {
+        char buf[10];
+        size_t n = 0;
+        while (value >= 0x80) {
+            buf[n++] = (char)(value | 0x80);
+            value >>= 7;
+        }
+        buf[n++] = (char)value;
+        out_.append(buf, n);
+    }
+
+private:
+    std::string& out_;
+};
+
+class binary_reader {
+public:
+    binary_reader(const char* data, size_t size)
+        : cur_(data), end_(data + size) {}
+
+    void read(void* data, size_t size)
+    {
+        if (remaining() < size) {
+            throw std::logic_error("binary_reader: unexpected end of data");
+        }
+        if (size == 0) {  // 空vector的data()可能是空指针
+            return;
+        }
+        std::memcpy(data, cur_, size);
+        cur_ += size;
+    }
+
+    uint64_t read_varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cur_ == end_) {
+                throw std::logic_error("binary_reader: unexpected end of data");
+            }
+            unsigned char byte = (unsigned char)*cur_++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::logic_error("binary_reader: bad varint");
+    }
+
+    //读元素个数，顺便检查剩余数据至少够每个元素min_bytes字节，避免坏数据导致巨大的分配
+    size_t read_count(size_t min_bytes)
+    {
+        uint64_t count = read_varint();
+        if (min_bytes != 0 && count > remaining() / min_bytes) {
+            throw std::logic_error("binary_reader: bad element count");
+        }
+        return (size_t)count;
+    }
+
+    size_t remaining() const { return end_ - cur_; }
+
+private:
+    const char* cur_;
+    const char* end_;
+};
+
+//容器和元素的序列化互相递归，先声明
+template <typename T>
+void binary_write(binary_writer& writer, const T& value);
+template <typename T>
+void binary_read(binary_reader& reader, T& value);
+
+template <typename T>
+void binary_write(binary_writer& writer, const T& value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        char byte = value ? 1 : 0;
+        writer.write(&byte, 1);
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+        writer.write(&value, sizeof(T));
+    } else if constexpr (is_pair_v<T>) {
+        binary_write(writer, value.first);
+        binary_write(writer, value.second);
+    } else if constexpr (is_tuple_v<T>) {
+        std::apply([&writer](const auto&... elements) {
+            (binary_write(writer, elements), ...);
+        }, value);
+    } else if constexpr (is_bulk_copyable_v<T>) {
+        writer.write_varint(value.size());
+        writer.write(value.data(), value.size() * sizeof(*value.data()));
+    } else if constexpr (is_container_v<T>) {
+        writer.write_varint(value.size());
+        for (const auto& element : value) {
+            binary_write(writer, element);
+        }
+    } else {
+        static_assert(std::is_trivially_copyable_v<T>, "type can not be binary serialized");
+        writer.write(&value, sizeof(T));
+    }
+}
+
+template <typename T>
+void binary_read(binary_reader& reader, T& value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        //直接memcpy到bool里，不是0/1的字节就是未定义行为
+        char byte;
+        reader.read(&byte, 1);
+        value = byte != 0;
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+        reader.read(&value, sizeof(T));
+    } else if constexpr (is_pair_v<T>) {
+        binary_read(reader, value.first);
+        binary_read(reader, value.second);
+    } else if constexpr (is_tuple_v<T>) {
+        std::apply([&reader](auto&... elements) {
+            (binary_read(reader, elements), ...);
+        }, value);
+    } else if constexpr (is_bulk_copyable_v<T>) {
+        using element_type = std::remove_pointer_t<decltype(value.data())>;
+        size_t count = reader.read_count(sizeof(element_type));
+        if constexpr (has_resize<T>::value) {
+            value.resize(count);
+        } else if (count != value.size()) {  // std::array
+            throw std::logic_error("binary_read: array size mismatch");
+        }
+        reader.read(value.data(), count * sizeof(element_type));
+    } else if constexpr (is_container_v<T> && !has_clear<T>::value) {
+        size_t count = reader.read_count(1);
+        if (count != value.size()) {  // std::array
+            throw std::logic_error("binary_read: array size mismatch");
+        }
+        for (auto& element : value) {
+            binary_read(reader, element);
+        }
+    } else if constexpr (is_container_v<T>) {
+        using element_type = typename readable<typename T::value_type>::type;
+        size_t count = reader.read_count(1);
+        value.clear();
+        if constexpr (has_reserve<T>::value) {
+            value.reserve(count);
+        }
+        //顺序容器插到末尾，关联容器按已排好的顺序带hint插入，都是均摊O(1)
+        for (size_t i = 0; i < count; i++) {
+            element_type element{};
+            binary_read(reader, element);
+            value.insert(value.end(), std::move(element));
+        }
+    } else {
+        static_assert(std::is_trivially_copyable_v<T>, "type can not be binary serialized");
+        reader.read(&value, sizeof(T));
+    }
+}
+
+template <typename T>
+std::string binary_dump(const T& value)
+{
+    std::string out;
+    binary_writer writer(out);
+    binary_write(writer, value);
+    return out;
+}
+
+//数据不完整或有多余字节时抛std::logic_error
+template <typename T>
+void binary_load(const std::string& data, T& value)
+{
+    binary_reader reader(data.data(), data.size());
+    binary_read(reader, value);
+    if (reader.remaining() != 0) {
+        throw std::logic_error("binary_load: trailing data");
+    }
+}
+
+//检查点写到文件/从文件恢复
+template <typename T>
+void binary_save_file(const std::string& filename, const T& value)
+{
+    std::string data = binary_dump(value);
+    std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+    fout.write(data.data(), data.size());
+    if (!fout) {
+        throw std::logic_error("write file failed: " + filename);
+    }
+}
+
+template <typename T>
+void binary_load_file(const std::string& filename, T& value)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin) {
+        throw std::logic_error("open file failed: " + filename);
+    }
+    std::string data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    binary_load(data, value);
+}
+
+#endif // BINARY_SERIALIZE_H
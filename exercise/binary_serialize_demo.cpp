@@ -0,0 +1,84 @@
+// g++ binary_serialize_demo.cpp -std=c++17 -O2 -o binary_serialize_demo
+#include "binary_serialize.h"
+#include <array>
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+enum class Color : uint8_t { red, green, blue };
+
+//写出再读回，结果必须和原值相等
+template <typename T>
+void round_trip(const char* name, const T& value)
+{
+    std::string data = binary_dump(value);
+    T loaded{};
+    binary_load(data, loaded);
+    assert(loaded == value);
+    std::cout << name << ": " << data.size() << " bytes ok" << std::endl;
+}
+
+template <typename T>
+bool load_throws(const std::string& data)
+{
+    T value{};
+    try {
+        binary_load(data, value);
+    } catch (const std::logic_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    round_trip("int", 42);
+    round_trip("double", 3.5);
+    round_trip("bool", true);
+    round_trip("enum", Color::blue);
+    round_trip("string", std::string("checkpoint"));
+    round_trip("empty vector", std::vector<int>());
+    round_trip("vector<int>", std::vector<int>{1, 2, 3, 4, 5});
+    round_trip("vector<bool>", std::vector<bool>{true, false, true});
+    round_trip("vector<string>", std::vector<std::string>{"a", "", "ccc"});
+    round_trip("list<double>", std::list<double>{0.5, 1.5});
+    round_trip("deque<int>", std::deque<int>{7, 8, 9});
+    round_trip("set<string>", std::set<std::string>{"x", "y"});
+    round_trip("array<int, 3>", std::array<int, 3>{1, 2, 3});
+    round_trip("array<bool, 4>", std::array<bool, 4>{true, false, false, true});
+    round_trip("array<string, 3>", std::array<std::string, 3>{"one", "two", "three"});
+    round_trip("pair", std::make_pair(std::string("key"), 10));
+    round_trip("tuple", std::make_tuple(1, std::string("two"), 3.0, Color::green));
+    round_trip("map<string, vector<int>>",
+               std::map<std::string, std::vector<int>>{{"a", {1, 2}}, {"b", {}}, {"c", {3}}});
+    round_trip("unordered_map<int, string>", std::unordered_map<int, std::string>{{1, "one"}, {2, "two"}});
+    round_trip("nested", std::vector<std::pair<int, std::array<std::string, 2>>>{{1, {"a", "b"}}, {2, {"c", ""}}});
+
+    //bool读的是一个字节，非0即true
+    bool flag = false;
+    binary_load(std::string(1, '\x02'), flag);
+    assert(flag);
+
+    //数据不完整、元素个数不对、有多余字节都抛异常
+    std::string data = binary_dump(std::vector<int>{1, 2, 3});
+    assert(load_throws<std::vector<int>>(data.substr(0, data.size() - 1)));
+    assert(load_throws<std::vector<int>>(data + "x"));
+    assert((load_throws<std::array<int, 2>>(data)));
+    assert((load_throws<std::array<std::string, 2>>(binary_dump(std::vector<std::string>{"a", "b", "c"}))));
+
+    //检查点文件
+    std::map<int, std::string> state{{1, "alpha"}, {2, "beta"}};
+    binary_save_file("./checkpoint.bin", state);
+    std::map<int, std::string> restored;
+    binary_load_file("./checkpoint.bin", restored);
+    assert(restored == state);
+    std::cout << "file round trip ok" << std::endl;
+    return 0;
+}
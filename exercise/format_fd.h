@@ -0,0 +1,40 @@
+#ifndef FORMAT_FD_H
+#define FORMAT_FD_H
+
+// template.h里format_write的文件描述符版本，依赖POSIX的write，单独放在这里，
+// template.h本身只用标准库
+
+#include "template.h"
+#include <errno.h>      // errno/EINTR
+#include <unistd.h>     // write
+
+//写到文件描述符，处理短写和EINTR，失败返回false
+inline bool format_write_to(int fd, const format_buffer& buf)
+{
+    const char* data = buf.data();
+    size_t size = buf.size();
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+//渲染完再一次write到fd，绕过ostream
+template <typename T>
+bool format_write(int fd, const T& value,
+                  format_limits limits = format_limits())
+{
+    format_buffer buf(limits);
+    format_value(buf, value);
+    return format_write_to(fd, buf);
+}
+
+#endif // FORMAT_FD_H
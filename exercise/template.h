@@ -36,6 +36,15 @@
 #include <ostream>      // std::ostream
 #include <type_traits>  // std::false_type/true_type/decay_t/is_same_v
 #include <utility>      // std::declval/pair
+#include <algorithm>    // std::min
+#include <charconv>     // std::to_chars
+#include <cstdint>      // SIZE_MAX
+#include <cstdlib>      // std::malloc/realloc/free
+#include <cstring>      // std::memcpy
+#include <new>          // std::bad_alloc
+#include <sstream>      // std::ostringstream
+#include <string_view>  // std::string_view
+#include <tuple>        // std::tuple/apply
 
 // Type trait to detect std::pair
 
@@ -161,4 +170,259 @@ std::ostream& operator<<(std::ostream& os, const std::pair<T, U>& pr)
     return os;
 }
 
+// ---------------------------------------------------------------------
+// 高吞吐的格式化：输出格式和上面的operator<<一致，
+// 但先把整个对象渲染进一块可增长的char缓冲区，最后一次写出
+// 数值用std::to_chars，不经过ostream的locale和虚函数
+// 注意浮点数按最短可还原的格式输出，和ostream默认的6位有效数字不同
+// 额外支持std::tuple，以及按元素个数/字节数截断
+
+// 截断设置：每个容器最多输出max_elements个元素，后面用"..."代替；
+// 总输出超过max_bytes字节时截断，结尾加"..."
+struct format_limits {
+    size_t max_elements = SIZE_MAX;
+    size_t max_bytes = SIZE_MAX;
+};
+
+class format_buffer {
+public:
+    explicit format_buffer(format_limits limits = format_limits())
+        : limits_(limits) {}
+    ~format_buffer() { std::free(data_); }
+    format_buffer(const format_buffer&) = delete;
+    format_buffer& operator=(const format_buffer&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool truncated() const { return truncated_; }
+    const format_limits& limits() const { return limits_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+    void clear()
+    {
+        size_ = 0;
+        truncated_ = false;
+        room_ = std::min(capacity_, limits_.max_bytes);
+    }
+
+    //快路径只比较一次剩余空间
+    void append(char c)
+    {
+        if (size_ < room_) {
+            data_[size_++] = c;
+            return;
+        }
+        append_slow(&c, 1);
+    }
+
+    //还没分配内存时data_是空指针，长度为0时不能交给memcpy
+    void append(const char* s, size_t n)
+    {
+        if (n == 0) {
+            return;
+        }
+        if (n <= room_ - size_) {
+            std::memcpy(data_ + size_, s, n);
+            size_ += n;
+            return;
+        }
+        append_slow(s, n);
+    }
+
+    void append(std::string_view s) { append(s.data(), s.size()); }
+
+    //整数最多20位，浮点数的最短表示最多24字节
+    template <typename T>
+    void append_number(T value)
+    {
+        char tmp[32];
+        auto result = std::to_chars(tmp, tmp + sizeof(tmp), value);
+        append(tmp, result.ptr - tmp);
+    }
+
+    void write_to(std::ostream& os) const { os.write(data_, size_); }
+
+private:
+    //空间不够时扩容，超过max_bytes时写能写下的部分再加省略号，之后的写入都忽略
+    void append_slow(const char* s, size_t n)
+    {
+        if (truncated_) {
+            return;
+        }
+        bool cut = limits_.max_bytes - size_ < n;
+        if (cut) {
+            n = limits_.max_bytes - size_;
+        }
+        reserve(size_ + n + (cut ? 3 : 0));
+        if (n > 0) {
+            std::memcpy(data_ + size_, s, n);
+        }
+        size_ += n;
+        if (cut) {
+            std::memcpy(data_ + size_, "...", 3);
+            size_ += 3;
+            truncated_ = true;
+            room_ = size_;
+        } else {
+            room_ = std::min(capacity_, limits_.max_bytes);
+        }
+    }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity <= capacity_) {
+            return;
+        }
+        size_t grown = capacity_ == 0 ? 256 : capacity_ * 2;
+        while (grown < capacity) {
+            grown *= 2;
+        }
+        char* data = (char*)std::realloc(data_, grown);
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+        data_ = data;
+        capacity_ = grown;
+    }
+
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    size_t room_ = 0;   //min(capacity_, max_bytes)，截断后等于size_
+    bool truncated_ = false;
+    format_limits limits_;
+};
+
+// Type trait to detect std::tuple
+template <typename T>
+struct is_tuple : std::false_type {};
+template <typename... Args>
+struct is_tuple<std::tuple<Args...>> : std::true_type {};
+template <typename T>
+inline constexpr bool is_tuple_v = is_tuple<T>::value;
+
+// Type trait to detect containers (begin()/end()) and associative
+// containers (key_type)
+template <typename T, typename = void>
+struct is_container : std::false_type {};
+template <typename T>
+struct is_container<T, std::void_t<decltype(std::declval<const T&>().begin(),
+                                            std::declval<const T&>().end())>>
+    : std::true_type {};
+template <typename T>
+inline constexpr bool is_container_v = is_container<T>::value;
+
+template <typename T, typename = void>
+struct has_key_type : std::false_type {};
+template <typename T>
+struct has_key_type<T, std::void_t<typename T::key_type>> : std::true_type {};
+
+//和operator<<一样，容器和元素的格式化互相递归，先声明
+template <typename T>
+void format_value(format_buffer& buf, const T& value);
+
+template <typename Cont>
+void format_container(format_buffer& buf, const Cont& container)
+{
+    using element_type = std::decay_t<decltype(*container.begin())>;
+    if constexpr (std::is_same_v<element_type, char>) {
+        for (char c : container) {
+            if (c == '\0') {
+                break;
+            }
+            buf.append(c);
+        }
+    } else {
+        buf.append('{');
+        size_t max_elements = buf.limits().max_elements;
+        size_t count = 0;
+        for (const auto& element : container) {
+            if (count == max_elements) {
+                buf.append(count == 0 ? " ..." : ", ...", count == 0 ? 4 : 5);
+                count++;
+                break;
+            }
+            if (count == 0) {
+                buf.append(' ');
+            } else {
+                buf.append(", ", 2);
+            }
+            if constexpr (is_pair_v<element_type> && has_key_type<Cont>::value) {
+                format_value(buf, element.first);
+                buf.append(" => ", 4);
+                format_value(buf, element.second);
+            } else {
+                format_value(buf, element);
+            }
+            count++;
+            if (buf.truncated()) {
+                return;
+            }
+        }
+        if (count != 0) {  // Not empty
+            buf.append(' ');
+        }
+        buf.append('}');
+    }
+}
+
+template <typename T>
+void format_value(format_buffer& buf, const T& value)
+{
+    using type = std::decay_t<T>;
+    if constexpr (std::is_same_v<type, bool>) {
+        buf.append(value ? '1' : '0');
+    } else if constexpr (std::is_same_v<type, char> ||
+                         std::is_same_v<type, signed char> ||
+                         std::is_same_v<type, unsigned char>) {
+        //和ostream一样，char类按字符输出
+        buf.append((char)value);
+    } else if constexpr (std::is_arithmetic_v<type>) {
+        buf.append_number(value);
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        buf.append(std::string_view(value));
+    } else if constexpr (is_pair_v<type>) {
+        buf.append('(');
+        format_value(buf, value.first);
+        buf.append(", ", 2);
+        format_value(buf, value.second);
+        buf.append(')');
+    } else if constexpr (is_tuple_v<type>) {
+        buf.append('(');
+        std::apply([&buf](const auto&... elements) {
+            bool first = true;
+            ((first ? (void)(first = false) : buf.append(", ", 2),
+              format_value(buf, elements)), ...);
+        }, value);
+        buf.append(')');
+    } else if constexpr (is_container_v<type>) {
+        format_container(buf, value);
+    } else {
+        //其他有operator<<的类型退回到ostream
+        std::ostringstream os;
+        os << value;
+        buf.append(os.str());
+    }
+}
+
+//把value追加到buf
+template <typename T>
+void format_to(format_buffer& buf, const T& value)
+{
+    format_value(buf, value);
+}
+
+//渲染完再一次写到os
+template <typename T>
+std::ostream& format_write(std::ostream& os, const T& value,
+                           format_limits limits = format_limits())
+{
+    format_buffer buf(limits);
+    format_value(buf, value);
+    buf.write_to(os);
+    return os;
+}
+
+//写到文件描述符的版本依赖POSIX，在format_fd.h里
+
 #endif // OUTPUT_CONTAINER_H
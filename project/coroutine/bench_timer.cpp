@@ -0,0 +1,153 @@
+#include "timing_wheel.h"
+#include "coro.h"
+#include <queue>
+#include <random>
+// g++ bench_timer.cpp -std=c++20 -O2 -o bench_timer
+
+// 对照组：std::priority_queue做的最小堆，取消时只打标记，出堆时跳过(惰性删除)
+class timer_heap {
+public:
+  using timer_id = uint64_t;
+
+  auto add(uint64_t expiry, std::function<void()> fn) -> timer_id {
+    timer_id id = m_callbacks.size();
+    m_callbacks.push_back(std::move(fn));
+    m_heap.push({expiry, id});
+    return id;
+  }
+
+  auto cancel(timer_id id) -> bool {
+    if (!m_callbacks[id]) {
+      return false;
+    }
+    m_callbacks[id] = nullptr;
+    return true;
+  }
+
+  auto advance(uint64_t tick) -> size_t {
+    size_t fired = 0;
+    while (!m_heap.empty() && m_heap.top().expiry <= tick) {
+      timer_id id = m_heap.top().id;
+      m_heap.pop();
+      if (m_callbacks[id]) {
+        auto fn = std::move(m_callbacks[id]);
+        m_callbacks[id] = nullptr;
+        fn();
+        fired++;
+      }
+    }
+    return fired;
+  }
+
+private:
+  struct entry {
+    uint64_t expiry;
+    timer_id id;
+    auto operator<(const entry &other) const -> bool { return expiry > other.expiry; }
+  };
+
+  std::priority_queue<entry> m_heap;
+  std::vector<std::function<void()>> m_callbacks;
+};
+
+template <typename F> auto time_ns(F f) -> double {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 1. 插入n个到期时间随机的定时器，取消一半，然后一个tick一个tick地推进直到全部到期
+template <typename Timers> auto bench_phases(const char *name, size_t n, uint64_t range) -> void {
+  Timers timers;
+  std::mt19937_64 rng(42);
+  std::vector<uint64_t> delays(n);
+  for (auto &d : delays) {
+    d = 1 + rng() % range;
+  }
+  std::vector<uint64_t> ids(n);
+  size_t fired = 0;
+
+  double insert = time_ns([&] {
+    for (size_t i = 0; i < n; i++) {
+      ids[i] = timers.add(delays[i], [&fired] { fired++; });
+    }
+  });
+  double cancel = time_ns([&] {
+    for (size_t i = 0; i < n; i += 2) {
+      timers.cancel(ids[i]);
+    }
+  });
+  double expire = time_ns([&] {
+    for (uint64_t tick = 1; tick <= range; tick++) {
+      timers.advance(tick);
+    }
+  });
+
+  std::cout << name << " n=" << n << " range=" << range << ": insert=" << insert / n
+            << "ns cancel=" << cancel / (n / 2) << "ns expire=" << expire / fired
+            << "ns/timer (fired " << fired << ")" << std::endl;
+}
+
+// 2. 请求超时：每个tick来一批请求，各带一个5秒的超时，绝大多数请求在超时前完成并取消定时器
+template <typename Timers> auto bench_deadlines(const char *name, size_t per_tick, uint64_t ticks) -> void {
+  Timers timers;
+  std::mt19937_64 rng(7);
+  std::deque<uint64_t> pending;
+  size_t fired = 0, ops = 0;
+  double total = time_ns([&] {
+    for (uint64_t tick = 1; tick <= ticks; tick++) {
+      for (size_t i = 0; i < per_tick; i++) {
+        pending.push_back(timers.add(tick + 5000, [&fired] { fired++; }));
+      }
+      // 请求大约100个tick后完成，1%的请求永远不完成
+      while (pending.size() > per_tick * 100) {
+        if (rng() % 100 != 0) {
+          timers.cancel(pending.front());
+        }
+        pending.pop_front();
+        ops++;
+      }
+      timers.advance(tick);
+      ops += per_tick;
+    }
+  });
+  std::cout << name << " deadlines " << per_tick << "/tick: " << total / ops << "ns/op (fired " << fired
+            << ")" << std::endl;
+}
+
+// 协程等待时间轮：n个协程各自睡随机的时长
+auto bench_coroutines(size_t n) -> void {
+  timing_wheel wheel;
+  std::mt19937_64 rng(1);
+  size_t woken = 0;
+  auto sleeper = [&](uint64_t delay) -> task<> {
+    co_await wheel.sleep_for(delay);
+    woken++;
+  };
+  std::vector<task<>> tasks;
+  tasks.reserve(n);
+  double start = time_ns([&] {
+    for (size_t i = 0; i < n; i++) {
+      tasks.push_back(sleeper(1 + rng() % 10000));
+      tasks.back().resume();
+    }
+  });
+  double run = time_ns([&] {
+    for (uint64_t tick = 1; tick <= 10000; tick++) {
+      wheel.advance(tick);
+    }
+  });
+  std::cout << "task<> co_await sleep_for n=" << n << ": start=" << start / n << "ns wake=" << run / n
+            << "ns (woken " << woken << ")" << std::endl;
+}
+
+int main() {
+  for (size_t n : {100000, 500000}) {
+    bench_phases<timer_heap>("priority_queue", n, 1 << 16);
+    bench_phases<timing_wheel>("timing_wheel  ", n, 1 << 16);
+  }
+  bench_deadlines<timer_heap>("priority_queue", 100, 20000);
+  bench_deadlines<timing_wheel>("timing_wheel  ", 100, 20000);
+  bench_coroutines(200000);
+  return 0;
+}
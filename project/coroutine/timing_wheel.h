@@ -0,0 +1,300 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// 分层时间轮：4层，每层256个槽位，按tick计时，覆盖2^32个tick(1ms一个tick约49天)
+// 第0层每个槽位是一个tick，第n层每个槽位是256^n个tick；定时器按离到期还有多远放到对应的层
+// 时间走到某一层的槽位时，把里面的定时器重新分配到更低的层(cascade)，最终都从第0层到期
+// 插入和取消都是O(1)：定时器是节点池里的双向链表节点，按下标链接，不单独分配内存
+// 到期处理是批量的：先把所有到期槽位整条链表接到待执行链表上，再逐个执行回调
+// 单线程使用，一般由事件循环驱动：定期调用advance(当前时间)
+class timing_wheel {
+public:
+  using clock = std::chrono::steady_clock;
+  using callback = std::function<void()>;
+  // 高32位是代数，低32位是节点下标；节点复用后旧的id自动失效，0表示无效
+  using timer_id = uint64_t;
+
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 8;
+  static constexpr uint32_t kSlots = 1u << kSlotBits;
+
+  explicit timing_wheel(clock::duration tick = std::chrono::milliseconds(1),
+                        clock::time_point start = clock::now())
+      : m_tick(tick), m_start(start), m_links(kLists) {
+    for (uint32_t i = 0; i < kLists; i++) {
+      m_links[i].prev = m_links[i].next = i;
+    }
+  }
+
+  timing_wheel(const timing_wheel &) = delete;
+  auto operator=(const timing_wheel &) -> timing_wheel & = delete;
+
+  // 已经处理到的tick，所有到期时间<=now()的定时器都已执行
+  auto now() const noexcept -> uint64_t { return m_next - 1; }
+  auto size() const noexcept -> size_t { return m_count; }
+  auto empty() const noexcept -> bool { return m_count == 0; }
+
+  // 时间点对应的tick(向下取整)，早于起始时间时为0
+  auto tick_of(clock::time_point tp) const -> uint64_t {
+    return tp <= m_start ? 0 : (uint64_t)((tp - m_start) / m_tick);
+  }
+
+  // 时长对应的tick数(向上取整)
+  auto ticks(clock::duration d) const -> uint64_t {
+    return d <= clock::duration::zero() ? 0 : (uint64_t)((d + m_tick - clock::duration(1)) / m_tick);
+  }
+
+  // 在第expiry个tick到期；已经过去的时间在下一个tick到期；fn不能为空
+  auto add(uint64_t expiry, callback fn) -> timer_id {
+    uint32_t index = acquire();
+    node &n = m_nodes[index - kLists];
+    n.expiry = expiry < m_next ? m_next : expiry;
+    n.fn = std::move(fn);
+    place(index);
+    m_count++;
+    return ((uint64_t)n.generation << 32) | index;
+  }
+
+  // 按tick数：在第now() + delay个tick到期
+  auto add_after(uint64_t delay, callback fn) -> timer_id {
+    return add(now() + delay, std::move(fn));
+  }
+
+  // 按时长：实际时间可能已经比now()晚了不到一个tick，多加一个tick保证不会提前到期(最多晚一个tick)
+  auto add_after(clock::duration delay, callback fn) -> timer_id {
+    return add(now() + 1 + ticks(delay), std::move(fn));
+  }
+
+  // 取消还没执行的定时器；已经执行、已经取消或者无效的id返回false
+  // 在回调里取消同一批到期但还没执行的定时器也可以
+  auto cancel(timer_id id) -> bool {
+    uint32_t index = (uint32_t)id;
+    if (index < kLists || index - kLists >= m_nodes.size()) {
+      return false;
+    }
+    node &n = m_nodes[index - kLists];
+    if (n.generation != (uint32_t)(id >> 32) || !n.fn) {
+      return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+  }
+
+  // 把时间推进到第tick个tick，执行所有到期的定时器，返回执行的个数
+  auto advance(uint64_t tick) -> size_t {
+    if (m_count == 0 && tick >= m_next) {
+      m_next = tick + 1;  // 没有定时器，直接跳过去
+    }
+    while (m_next <= tick) {
+      uint32_t index = (uint32_t)(m_next & (kSlots - 1));
+      if (index == 0) {
+        cascade(1);
+      }
+      // 本轮(256个tick)内跳过空槽位，直接走到下一个有定时器的槽位
+      uint32_t slot = next_slot(index);
+      uint64_t target = m_next - index + slot;
+      if (target > tick) {
+        m_next = tick + 1;
+        break;
+      }
+      m_next = target;
+      if (slot == kSlots) {
+        continue;  // 本轮已经没有定时器，下一轮开始时cascade
+      }
+      splice(slot_list(0, slot), kExpired);
+      m_next++;
+    }
+    return run_expired();
+  }
+
+  auto advance(clock::time_point tp) -> size_t { return advance(tick_of(tp)); }
+
+  // co_await wheel.sleep_until(tick) / co_await wheel.sleep_for(delay)
+  // 到期时在advance()里恢复等待的协程；协程在等待时被销毁会自动取消定时器
+  struct sleep_awaitable {
+    sleep_awaitable(timing_wheel &wheel, uint64_t expiry) noexcept
+        : m_wheel(wheel), m_expiry(expiry) {}
+    sleep_awaitable(const sleep_awaitable &) = delete;
+    ~sleep_awaitable() { m_wheel.cancel(m_id); }
+
+    auto await_ready() const noexcept -> bool { return m_expiry <= m_wheel.now(); }
+
+    auto await_suspend(std::coroutine_handle<> coroutine) -> void {
+      m_id = m_wheel.add(m_expiry, [coroutine] { coroutine.resume(); });
+    }
+
+    auto await_resume() noexcept -> void { m_id = 0; }
+
+  private:
+    timing_wheel &m_wheel;
+    uint64_t m_expiry;
+    timer_id m_id{0};
+  };
+
+  auto sleep_until(uint64_t expiry) -> sleep_awaitable { return {*this, expiry}; }
+  auto sleep_until(clock::time_point tp) -> sleep_awaitable {
+    return {*this, tick_of(tp + m_tick - clock::duration(1))};  // 向上取整到tick边界
+  }
+  auto sleep_for(uint64_t delay) -> sleep_awaitable { return {*this, now() + delay}; }
+  // 和add_after(duration)一样多等一个tick
+  auto sleep_for(clock::duration delay) -> sleep_awaitable {
+    return {*this, now() + 1 + ticks(delay)};
+  }
+
+private:
+  // 前kLevels * kSlots个链接是各槽位的哨兵，接着一个是待执行链表的哨兵，后面是定时器节点
+  static constexpr uint32_t kExpired = kLevels * kSlots;
+  static constexpr uint32_t kLists = kExpired + 1;
+  static constexpr uint32_t kNil = 0xffffffffu;
+
+  struct link {
+    uint32_t prev;
+    uint32_t next;
+  };
+
+  struct node {
+    uint64_t expiry = 0;
+    uint32_t generation = 0;
+    callback fn;  // 为空表示节点空闲
+  };
+
+  static auto slot_list(int level, uint32_t slot) -> uint32_t {
+    return (uint32_t)level * kSlots + slot;
+  }
+
+  auto acquire() -> uint32_t {
+    uint32_t index;
+    if (m_free != kNil) {
+      index = m_free;
+      m_free = m_links[index].next;
+    } else {
+      index = (uint32_t)m_links.size();
+      m_links.push_back({});
+      m_nodes.emplace_back();
+    }
+    node &n = m_nodes[index - kLists];
+    if (++n.generation == 0) {
+      n.generation = 1;
+    }
+    return index;
+  }
+
+  auto release(uint32_t index) -> void {
+    m_nodes[index - kLists].fn = nullptr;
+    m_links[index].next = m_free;
+    m_free = index;
+    m_count--;
+  }
+
+  auto push_back(uint32_t list, uint32_t index) -> void {
+    link &head = m_links[list];
+    m_links[index].prev = head.prev;
+    m_links[index].next = list;
+    m_links[head.prev].next = index;
+    head.prev = index;
+  }
+
+  auto unlink(uint32_t index) -> void {
+    link &l = m_links[index];
+    m_links[l.prev].next = l.next;
+    m_links[l.next].prev = l.prev;
+  }
+
+  // 把from整条链表接到to的末尾，O(1)
+  auto splice(uint32_t from, uint32_t to) -> void {
+    link &src = m_links[from];
+    if (src.next == from) {
+      return;
+    }
+    uint32_t first = src.next;
+    uint32_t last = src.prev;
+    link &dst = m_links[to];
+    m_links[dst.prev].next = first;
+    m_links[first].prev = dst.prev;
+    m_links[last].next = to;
+    dst.prev = last;
+    src.prev = src.next = from;
+  }
+
+  // 按离到期的距离选层，槽位由到期时间本身的对应位决定
+  // 超出范围的放在最高层最远的位置，cascade时会重新计算
+  auto place(uint32_t index) -> void {
+    uint64_t expiry = m_nodes[index - kLists].expiry;
+    uint64_t delta = expiry - m_next;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= ((uint64_t)1 << (kSlotBits * (level + 1)))) {
+      level++;
+    }
+    uint64_t max_delta = ((uint64_t)1 << (kSlotBits * kLevels)) - 1;
+    if (delta > max_delta) {
+      expiry = m_next + max_delta;
+    }
+    uint32_t slot = (uint32_t)(expiry >> (kSlotBits * level)) & (kSlots - 1);
+    push_back(slot_list(level, slot), index);
+    if (level == 0) {
+      m_occupied[slot / 64] |= (uint64_t)1 << (slot % 64);
+    }
+  }
+
+  // 进入新的一轮时，把上一层当前槽位里的定时器分配到下面的层；上一层也转完一圈时继续往上
+  auto cascade(int level) -> void {
+    uint32_t slot = (uint32_t)(m_next >> (kSlotBits * level)) & (kSlots - 1);
+    uint32_t list = slot_list(level, slot);
+    while (m_links[list].next != list) {
+      uint32_t index = m_links[list].next;
+      unlink(index);
+      place(index);
+    }
+    if (slot == 0 && level + 1 < kLevels) {
+      cascade(level + 1);
+    }
+  }
+
+  // 第0层从slot开始第一个非空槽位，没有返回kSlots；顺便清掉已经空了的标记位
+  auto next_slot(uint32_t slot) -> uint32_t {
+    while (slot < kSlots) {
+      uint64_t bits = m_occupied[slot / 64] >> (slot % 64);
+      if (bits == 0) {
+        slot = (slot / 64 + 1) * 64;
+        continue;
+      }
+      slot += (uint32_t)__builtin_ctzll(bits);
+      uint32_t list = slot_list(0, slot);
+      if (m_links[list].next != list) {
+        return slot;
+      }
+      m_occupied[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    }
+    return kSlots;
+  }
+
+  auto run_expired() -> size_t {
+    size_t fired = 0;
+    while (m_links[kExpired].next != kExpired) {
+      uint32_t index = m_links[kExpired].next;
+      unlink(index);
+      callback fn = std::move(m_nodes[index - kLists].fn);
+      release(index);
+      fn();
+      fired++;
+    }
+    return fired;
+  }
+
+private:
+  clock::duration m_tick;
+  clock::time_point m_start;
+  uint64_t m_next{1};  // 下一个要处理的tick
+  size_t m_count{0};
+  uint32_t m_free{kNil};
+  std::vector<link> m_links;
+  std::vector<node> m_nodes;
+  uint64_t m_occupied[kSlots / 64]{};  // 第0层哪些槽位可能非空
+};
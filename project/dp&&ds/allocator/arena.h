@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace alloc{
+
+// 单调增长的内存区
+// 分配只是在当前块上移动指针，不能单独释放，release()时一次全部归还
+// 适合生命周期一致的一批临时对象(一次请求、一帧、一次解析)
+// 不是线程安全的，一般每个线程/每个任务一个
+class monotonic_arena
+{
+public:
+	// buffer不为空时先用调用者提供的内存(比如栈上数组)，用完再向系统申请
+	explicit monotonic_arena(size_t initial = 4096, void* buffer = nullptr, size_t bufferSize = 0)
+		: m_chunks(nullptr), m_next(initial < 64 ? 64 : initial),
+		  m_cur((unsigned char*)buffer), m_end((unsigned char*)buffer + bufferSize)
+	{
+	}
+
+	~monotonic_arena()
+	{
+		release();
+	}
+
+	monotonic_arena(const monotonic_arena&) = delete;
+	monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+	void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+	{
+		unsigned char* p = align_up(m_cur, align);
+		if (m_cur == nullptr || p + size > m_end)
+		{
+			grow(size + align);
+			p = align_up(m_cur, align);
+		}
+		m_cur = p + size;
+		return p;
+	}
+
+	// 在arena上构造对象，析构函数不会被调用，只适合平凡析构的类型
+	template <typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// 归还向系统申请的所有块，调用者提供的buffer不再使用
+	void release()
+	{
+		while (m_chunks != nullptr)
+		{
+			chunk* next = m_chunks->next;
+			::operator delete(m_chunks);
+			m_chunks = next;
+		}
+		m_cur = nullptr;
+		m_end = nullptr;
+	}
+
+	// 已经向系统申请的字节数
+	size_t reserved() const
+	{
+		size_t total = 0;
+		for (chunk* c = m_chunks; c != nullptr; c = c->next)
+		{
+			total += c->size;
+		}
+		return total;
+	}
+
+private:
+	struct chunk
+	{
+		chunk* next;
+		size_t size;
+	};
+
+	static unsigned char* align_up(unsigned char* p, size_t align)
+	{
+		return (unsigned char*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+	}
+
+	// 每次申请的块按2倍增长，分配次数是对数级的
+	void grow(size_t need)
+	{
+		size_t size = m_next;
+		while (size < need + sizeof(chunk))
+		{
+			size *= 2;
+		}
+		m_next = size * 2;
+		chunk* c = (chunk*)::operator new(size);
+		c->next = m_chunks;
+		c->size = size;
+		m_chunks = c;
+		m_cur = (unsigned char*)(c + 1);
+		m_end = (unsigned char*)c + size;
+	}
+
+private:
+	chunk* m_chunks;
+	size_t m_next;
+	unsigned char* m_cur;
+	unsigned char* m_end;
+};
+
+// STL allocator适配，deallocate什么都不做，内存随arena一起释放
+template <typename T>
+class arena_allocator
+{
+	template <typename U>
+	friend class arena_allocator;
+
+public:
+	typedef T value_type;
+
+	explicit arena_allocator(monotonic_arena& arena) noexcept : m_arena(&arena) {}
+	template <typename U>
+	arena_allocator(const arena_allocator<U>& other) noexcept : m_arena(other.m_arena) {}
+
+	T* allocate(size_t n)
+	{
+		return (T*)m_arena->allocate(n * sizeof(T), alignof(T));
+	}
+
+	void deallocate(T*, size_t) noexcept {}
+
+	monotonic_arena* arena() const { return m_arena; }
+
+private:
+	monotonic_arena* m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& a, const arena_allocator<U>& b) { return a.arena() == b.arena(); }
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& a, const arena_allocator<U>& b) { return a.arena() != b.arena(); }
+
+} // namespace alloc
@@ -0,0 +1,159 @@
+// g++ bench_alloc.cpp -std=c++17 -O2 -pthread -o bench_alloc
+#include "slab_allocator.h"
+#include "arena.h"
+#include "../smart_ptr/shared_ptr.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <thread>
+#include <vector>
+using std::cout;
+using std::endl;
+
+template <typename F>
+double time_ns(size_t n, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+const size_t kObjectSize = 48;
+
+struct use_malloc
+{
+	static void* allocate() { return std::malloc(kObjectSize); }
+	static void deallocate(void* p) { std::free(p); }
+};
+
+typedef alloc::slab_pool<kObjectSize> use_slab;
+
+// 分配后马上释放 / 先分配一批再全部释放
+template <typename A>
+void bench_raw(const char* name)
+{
+	const size_t n = 4000000;
+	double single = time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			void* p = A::allocate();
+			*(volatile char*)p = 0;
+			A::deallocate(p);
+		}
+	});
+
+	const size_t batch = 100000;
+	std::vector<void*> ptrs(batch);
+	double bulk = time_ns(n, [&] {
+		for (size_t round = 0; round < n / batch; round++)
+		{
+			for (size_t i = 0; i < batch; i++)
+			{
+				ptrs[i] = A::allocate();
+			}
+			for (size_t i = 0; i < batch; i++)
+			{
+				A::deallocate(ptrs[batch - 1 - i]);
+			}
+		}
+	});
+
+	cout << name << ": alloc+free=" << single << "ns"
+		<< " batch alloc/free=" << bulk << "ns" << endl;
+}
+
+// 多线程同时分配释放，每个线程的对象在本线程释放
+template <typename A>
+void bench_threads(const char* name, unsigned threads)
+{
+	const size_t n = 2000000;
+	const size_t batch = 1000;
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&] {
+			std::vector<void*> ptrs(batch);
+			for (size_t round = 0; round < n / batch; round++)
+			{
+				for (size_t i = 0; i < batch; i++)
+				{
+					ptrs[i] = A::allocate();
+				}
+				for (size_t i = 0; i < batch; i++)
+				{
+					A::deallocate(ptrs[i]);
+				}
+			}
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	double sec = std::chrono::duration<double>(end - start).count();
+	cout << name << " threads=" << threads
+		<< " ops/s=" << n * threads / sec / 1e6 << "M" << endl;
+}
+
+// 节点型容器：插入一批再清空
+template <typename Map>
+double bench_map(Map& map)
+{
+	const size_t n = 1000000;
+	return time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			map.emplace((int)(i * 2654435761u), (int)i);
+		}
+		map.clear();
+	});
+}
+
+int main()
+{
+	bench_raw<use_malloc>("malloc");
+	bench_raw<use_slab>("slab_pool");
+
+	for (unsigned threads = 1; threads <= std::thread::hardware_concurrency() && threads <= 8; threads *= 2)
+	{
+		bench_threads<use_malloc>("malloc", threads);
+		bench_threads<use_slab>("slab_pool", threads);
+	}
+
+	{
+		std::map<int, int> plain;
+		std::map<int, int, std::less<int>, alloc::slab_allocator<std::pair<const int, int>>> slab;
+		alloc::monotonic_arena arena(1 << 20);
+		std::map<int, int, std::less<int>, alloc::arena_allocator<std::pair<const int, int>>>
+			arena_map{alloc::arena_allocator<std::pair<const int, int>>(arena)};
+		cout << "std::map insert+clear: std::allocator=" << bench_map(plain) << "ns"
+			<< " slab_allocator=" << bench_map(slab) << "ns"
+			<< " arena_allocator=" << bench_map(arena_map) << "ns"
+			<< " (arena reserved " << arena.reserved() / 1024 << "KB)" << endl;
+	}
+
+	{
+		const size_t n = 2000000;
+		struct Node { long a, b; };
+		double make = time_ns(n, [&] {
+			for (size_t i = 0; i < n; i++)
+			{
+				smart_ptr::make_shared<Node>();
+			}
+		});
+		double slab = time_ns(n, [&] {
+			for (size_t i = 0; i < n; i++)
+			{
+				smart_ptr::allocate_shared<Node>(alloc::slab_allocator<Node>());
+			}
+		});
+		cout << "shared_ptr create+destroy: make_shared=" << make << "ns"
+			<< " allocate_shared(slab)=" << slab << "ns" << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace alloc{
+
+namespace detail{
+
+struct free_node
+{
+	free_node* next;
+};
+
+// 一种块大小的中心仓库
+// 从系统一次申请一大块slab切成固定大小的块，按batch(kBatch个块串成的链表)在线程缓存和仓库之间搬运
+// 只有线程缓存空了或者攒多了才会来这里，锁的竞争被摊薄到每kBatch次分配一次
+class slab_depot
+{
+public:
+	static constexpr size_t kBatch = 64;
+	static constexpr size_t kSlabBytes = 64 * 1024;
+
+	slab_depot(size_t block, size_t align) : m_block(block), m_align(align) {}
+
+	// 故意不释放slab：线程缓存里的块可能在进程退出之后才还回来
+	~slab_depot() {}
+
+	slab_depot(const slab_depot&) = delete;
+	slab_depot& operator=(const slab_depot&) = delete;
+
+	free_node* pop_batch()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_batches.empty())
+		{
+			carve();
+		}
+		free_node* batch = m_batches.back();
+		m_batches.pop_back();
+		return batch;
+	}
+
+	void push_batch(free_node* batch)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_batches.push_back(batch);
+	}
+
+	// 不足一个batch的零散链表(线程退出时)
+	void push_list(free_node* head)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while (head != nullptr)
+		{
+			free_node* batch = head;
+			free_node* tail = head;
+			for (size_t i = 1; i < kBatch && tail->next != nullptr; i++)
+			{
+				tail = tail->next;
+			}
+			head = tail->next;
+			tail->next = nullptr;
+			m_batches.push_back(batch);
+		}
+	}
+
+	size_t block_size() const { return m_block; }
+
+private:
+	void carve()
+	{
+		size_t count = kSlabBytes / m_block;
+		if (count < kBatch)
+		{
+			count = kBatch;
+		}
+		count = count / kBatch * kBatch;
+		unsigned char* slab = (unsigned char*)::operator new(count * m_block, std::align_val_t(m_align));
+		for (size_t b = 0; b < count; b += kBatch)
+		{
+			for (size_t i = 0; i < kBatch; i++)
+			{
+				free_node* node = (free_node*)(slab + (b + i) * m_block);
+				node->next = i + 1 < kBatch ? (free_node*)(slab + (b + i + 1) * m_block) : nullptr;
+			}
+			m_batches.push_back((free_node*)(slab + b * m_block));
+		}
+	}
+
+private:
+	std::mutex m_mutex;
+	std::vector<free_node*> m_batches;
+	size_t m_block;
+	size_t m_align;
+};
+
+} // namespace detail
+
+// 固定大小的slab分配器，每种(Size, Align)一个实例，全部是静态函数
+// 分配和释放先走线程缓存(一个单链表)，不加锁也不碰共享的cache line
+// 线程缓存空了从仓库拿一个batch，超过两个batch还回去一个
+// 一个线程分配的块可以在另一个线程释放，进入释放者的线程缓存
+template <size_t Size, size_t Align = alignof(std::max_align_t)>
+class slab_pool
+{
+	static_assert((Align & (Align - 1)) == 0, "Align must be a power of 2");
+
+public:
+	static constexpr size_t align = Align < alignof(void*) ? alignof(void*) : Align;
+	static constexpr size_t block_size = ((Size < sizeof(void*) ? sizeof(void*) : Size) + align - 1) / align * align;
+
+	static void* allocate()
+	{
+		detail::free_node* node = t_head;
+		if (node == nullptr)
+		{
+			node = refill();
+		}
+		t_head = node->next;
+		t_count--;
+		return node;
+	}
+
+	static void deallocate(void* p)
+	{
+		detail::free_node* node = (detail::free_node*)p;
+		if (t_head == nullptr)
+		{
+			// 只释放不分配的线程也要在退出时把块还回去
+			t_releaser.active = true;
+		}
+		node->next = t_head;
+		t_head = node;
+		if (++t_count >= 2 * detail::slab_depot::kBatch)
+		{
+			flush();
+		}
+	}
+
+private:
+	static detail::slab_depot& depot()
+	{
+		static detail::slab_depot* depot = new detail::slab_depot(block_size, align);
+		return *depot;
+	}
+
+	static detail::free_node* refill()
+	{
+		t_releaser.active = true;
+		t_head = depot().pop_batch();
+		t_count = detail::slab_depot::kBatch;
+		return t_head;
+	}
+
+	// 把前kBatch个块切下来还给仓库
+	static void flush()
+	{
+		detail::free_node* batch = t_head;
+		detail::free_node* tail = batch;
+		for (size_t i = 1; i < detail::slab_depot::kBatch; i++)
+		{
+			tail = tail->next;
+		}
+		t_head = tail->next;
+		tail->next = nullptr;
+		t_count -= detail::slab_depot::kBatch;
+		depot().push_batch(batch);
+	}
+
+	// 线程退出时把缓存里的块都还给仓库
+	struct releaser
+	{
+		bool active = false;
+		~releaser()
+		{
+			if (active && t_head != nullptr)
+			{
+				depot().push_list(t_head);
+			}
+			t_head = nullptr;
+			t_count = 0;
+		}
+	};
+
+	// 热路径只碰这两个平凡类型的thread_local
+	static thread_local detail::free_node* t_head;
+	static thread_local size_t t_count;
+	static thread_local releaser t_releaser;
+};
+
+template <size_t Size, size_t Align>
+thread_local detail::free_node* slab_pool<Size, Align>::t_head = nullptr;
+template <size_t Size, size_t Align>
+thread_local size_t slab_pool<Size, Align>::t_count = 0;
+template <size_t Size, size_t Align>
+thread_local typename slab_pool<Size, Align>::releaser slab_pool<Size, Align>::t_releaser;
+
+// STL allocator适配
+// 单个对象(list/map/set的节点、allocate_shared的控制块)走slab_pool，
+// 一次分配多个的(vector的数组)退回到operator new
+template <typename T>
+class slab_allocator
+{
+public:
+	typedef T value_type;
+
+	slab_allocator() noexcept {}
+	template <typename U>
+	slab_allocator(const slab_allocator<U>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		if (n == 1)
+		{
+			return (T*)slab_pool<sizeof(T), alignof(T)>::allocate();
+		}
+		return (T*)::operator new(n * sizeof(T), std::align_val_t(alignof(T)));
+	}
+
+	void deallocate(T* p, size_t n) noexcept
+	{
+		if (n == 1)
+		{
+			slab_pool<sizeof(T), alignof(T)>::deallocate(p);
+			return;
+		}
+		::operator delete(p, std::align_val_t(alignof(T)));
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const slab_allocator<T>&, const slab_allocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const slab_allocator<T>&, const slab_allocator<U>&) { return false; }
+
+} // namespace alloc
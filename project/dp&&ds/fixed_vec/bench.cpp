@@ -0,0 +1,205 @@
+// g++ bench.cpp -std=c++17 -O2 -march=native -o bench
+#include "fixed_vec.h"
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+using std::cout;
+using std::endl;
+
+template <typename F>
+double time_ns(size_t n, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+// 对照组：每个运算都算出一个完整的临时数组，下一个运算再从内存里读回来
+namespace naive{
+
+template <typename T, size_t N>
+using Array = std::array<T, N>;
+
+template <typename T, size_t N, typename Op>
+Array<T, N> apply(const Array<T, N>& a, const Array<T, N>& b, Op op)
+{
+	Array<T, N> r;
+	for (size_t i = 0; i < N; i++)
+	{
+		r[i] = op(a[i], b[i]);
+	}
+	return r;
+}
+
+template <typename T, size_t N>
+Array<T, N> operator+(const Array<T, N>& a, const Array<T, N>& b) { return apply(a, b, [](T x, T y) { return x + y; }); }
+template <typename T, size_t N>
+Array<T, N> operator-(const Array<T, N>& a, const Array<T, N>& b) { return apply(a, b, [](T x, T y) { return x - y; }); }
+template <typename T, size_t N>
+Array<T, N> operator*(const Array<T, N>& a, const Array<T, N>& b) { return apply(a, b, [](T x, T y) { return x * y; }); }
+
+template <typename T, size_t N>
+Array<T, N> operator*(const Array<T, N>& a, T s)
+{
+	Array<T, N> r;
+	for (size_t i = 0; i < N; i++)
+	{
+		r[i] = a[i] * s;
+	}
+	return r;
+}
+
+template <typename T, size_t N>
+T sum(const Array<T, N>& a)
+{
+	T acc = a[0];
+	for (size_t i = 1; i < N; i++)
+	{
+		acc += a[i];
+	}
+	return acc;
+}
+
+} // namespace naive
+
+// 编译期长度
+static_assert(vec::FixedVec<float, 8>::size() == 8, "size");
+static_assert(decltype(vec::FixedVec<float, 8>() * 2.0f + vec::FixedVec<float, 8>())::size() == 8, "expression size");
+static_assert(alignof(vec::FixedVec<float, 16>) == 64, "align");
+// 整数向量乘0.5这种会截断的标量编译不过
+static_assert(!vec::detail::scalar_fits<int, double>() && !vec::detail::scalar_fits<int, long>(), "narrowing scalar");
+static_assert(vec::detail::scalar_fits<int, int>() && vec::detail::scalar_fits<float, double>(), "scalar");
+
+void check()
+{
+	vec::FixedVec<int, 8> a{1, 2, 3, 4, 5, 6, 7, 8};
+	vec::FixedVec<int, 8> b(10);
+	vec::FixedVec<int, 8> c{1, 2};  // 后面补0
+	assert(a.size() == 8 && c[1] == 2 && c[7] == 0);
+
+	vec::FixedVec<int, 8> r = a * 2 + b - c;
+	for (size_t i = 0; i < 8; i++)
+	{
+		assert(r[i] == a[i] * 2 + b[i] - c[i]);
+	}
+	r = 100 - a;
+	assert(r[0] == 99 && r[7] == 92);
+	r = -a / 1;
+	assert(r[3] == -4);
+
+	// 自赋值
+	r = a;
+	r += r * 2;
+	assert(r == (vec::FixedVec<int, 8>(a * 3)));
+	r -= 1;
+	assert(r[0] == 2);
+
+	assert(vec::sum(a) == 36);
+	assert(vec::dot(a, b) == 360);
+	assert(vec::sum(a * a) == 204);
+	assert(vec::min(a - 5) == -4 && vec::max(a) == 8);
+
+	// 分路归约和顺序累加只差舍入误差
+	vec::FixedVec<double, 1000> x;
+	double expect = 0;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		x[i] = 1.0 / (i + 1);
+		expect += x[i];
+	}
+	assert(std::fabs(vec::sum(x) - expect) < 1e-12);
+	cout << "checks ok" << endl;
+}
+
+// M个长度为N的向量，算 r = a * 2 + b - c * d，再求和
+template <size_t N>
+void bench(size_t m)
+{
+	typedef vec::FixedVec<float, N> Vec;
+	typedef naive::Array<float, N> Arr;
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<Vec> a(m), b(m), c(m), d(m), r(m);
+	std::vector<Arr> na(m), nb(m), nc(m), nd(m), nr(m);
+	for (size_t k = 0; k < m; k++)
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			na[k][i] = a[k][i] = dist(rng);
+			nb[k][i] = b[k][i] = dist(rng);
+			nc[k][i] = c[k][i] = dist(rng);
+			nd[k][i] = d[k][i] = dist(rng);
+		}
+	}
+
+	const int rounds = 20;
+	size_t elements = m * N * rounds;
+	double fused = time_ns(elements, [&] {
+		for (int round = 0; round < rounds; round++)
+		{
+			for (size_t k = 0; k < m; k++)
+			{
+				r[k] = a[k] * 2.0f + b[k] - c[k] * d[k];
+			}
+		}
+	});
+	double unfused = time_ns(elements, [&] {
+		using namespace naive;
+		for (int round = 0; round < rounds; round++)
+		{
+			for (size_t k = 0; k < m; k++)
+			{
+				nr[k] = na[k] * 2.0f + nb[k] - nc[k] * nd[k];
+			}
+		}
+	});
+	// 逐元素运算的顺序一样，编译器可能把乘加合成FMA，只差舍入误差
+	for (size_t k = 0; k < m; k++)
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			assert(std::fabs(r[k][i] - nr[k][i]) <= 1e-5f);
+		}
+	}
+
+	float fused_sum = 0, naive_sum = 0;
+	double reduce = time_ns(elements, [&] {
+		for (int round = 0; round < rounds; round++)
+		{
+			for (size_t k = 0; k < m; k++)
+			{
+				fused_sum += vec::dot(a[k], b[k]);
+			}
+		}
+	});
+	double reduce_naive = time_ns(elements, [&] {
+		for (int round = 0; round < rounds; round++)
+		{
+			for (size_t k = 0; k < m; k++)
+			{
+				naive_sum += naive::sum(naive::operator*(na[k], nb[k]));
+			}
+		}
+	});
+	assert(std::fabs(fused_sum - naive_sum) <= 1e-3f * (std::fabs(naive_sum) + m));
+
+	cout << "N=" << N << " m=" << m
+		<< " a*2+b-c*d: fused=" << fused << "ns/elem naive=" << unfused << "ns/elem"
+		<< " dot: fused=" << reduce << "ns/elem naive=" << reduce_naive << "ns/elem"
+		<< " (" << fused_sum << ")" << endl;
+}
+
+int main()
+{
+	check();
+	bench<16>(65536);
+	bench<64>(16384);
+	bench<256>(4096);
+	bench<1024>(1024);
+	return 0;
+}
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+
+// 长度在编译期确定的定长向量(从exercise/nontype_template.cpp里的MArray<T, N>发展而来)
+// 1. 按总字节数对齐到16/32/64字节，AVX2/AVX-512的对齐load/store可以直接用
+// 2. 表达式模板：a * 2 + b - c这样的链式运算只生成一个表达式对象，赋值时在一个循环里算完，没有临时向量
+// 3. 归约(sum/dot/min/max)按SIMD宽度分路累加，编译器可以向量化；N太小或T不是算术类型时退回普通循环
+// 不写intrinsics，全靠N是编译期常量、数据对齐、循环简单，让编译器生成SIMD指令(需要-O2以上，-march打开对应指令集)
+namespace vec{
+
+namespace detail{
+
+// 编译目标的SIMD宽度(字节)，只影响归约的分路数
+#if defined(__AVX512F__)
+constexpr size_t kSimdBytes = 64;
+#elif defined(__AVX__)
+constexpr size_t kSimdBytes = 32;
+#else
+constexpr size_t kSimdBytes = 16;
+#endif
+
+// 对齐只看类型和长度，不看编译选项，保证不同选项编译的代码看到的内存布局一致
+template <typename T, size_t N>
+constexpr size_t vec_align()
+{
+	constexpr size_t bytes = sizeof(T) * N;
+	constexpr size_t align = bytes >= 64 ? 64 : bytes >= 32 ? 32 : bytes >= 16 ? 16 : alignof(T);
+	return std::is_arithmetic<T>::value && align > alignof(T) ? align : alignof(T);
+}
+
+// 归约的分路数：一个SIMD寄存器能放的元素个数
+// 元素不够两个寄存器时分路没有意义，用普通循环
+template <typename T, size_t N>
+constexpr size_t reduce_lanes()
+{
+	constexpr size_t lanes = kSimdBytes / sizeof(T);
+	return std::is_arithmetic<T>::value && lanes > 1 && N >= 2 * lanes ? lanes : 1;
+}
+
+} // namespace detail
+
+// 所有表达式的基类(CRTP)，只用来在重载里识别表达式
+template <typename E>
+struct VecExpr
+{
+	const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <typename T, size_t N>
+class FixedVec;
+
+namespace detail{
+
+// 表达式里FixedVec按引用保存，中间表达式按值保存(它们是临时对象)
+template <typename E>
+struct expr_ref { typedef const E type; };
+template <typename T, size_t N>
+struct expr_ref<FixedVec<T, N>> { typedef const FixedVec<T, N>& type; };
+
+// 标量参与运算时包装成每个下标都返回同一个值的表达式
+template <typename T, size_t N>
+struct ScalarExpr : VecExpr<ScalarExpr<T, N>>
+{
+	typedef T value_type;
+	static constexpr size_t size() { return N; }
+
+	explicit ScalarExpr(T v) : value(v) {}
+	T operator[](size_t) const { return value; }
+
+	T value;
+};
+
+// 标量要先转换成向量的元素类型：浮点向量接受任何算术标量(最多损失精度)，
+// 整数向量只接受不收窄的标量，FixedVec<int> * 0.5不会悄悄变成乘0
+template <typename T, typename S, typename = void>
+struct non_narrowing : std::false_type {};
+template <typename T, typename S>
+struct non_narrowing<T, S, std::void_t<decltype(T{std::declval<S>()})>> : std::true_type {};
+
+template <typename T, typename S>
+constexpr bool scalar_fits()
+{
+	return std::is_floating_point<T>::value || non_narrowing<T, S>::value;
+}
+
+struct add { template <typename T> static T apply(T a, T b) { return a + b; } };
+struct sub { template <typename T> static T apply(T a, T b) { return a - b; } };
+struct mul { template <typename T> static T apply(T a, T b) { return a * b; } };
+struct div { template <typename T> static T apply(T a, T b) { return a / b; } };
+
+template <typename L, typename R, typename Op>
+struct BinaryExpr : VecExpr<BinaryExpr<L, R, Op>>
+{
+	typedef typename L::value_type value_type;
+	static constexpr size_t size() { return L::size(); }
+	static_assert(L::size() == R::size(), "FixedVec size mismatch");
+	static_assert(std::is_same<typename L::value_type, typename R::value_type>::value, "FixedVec type mismatch");
+
+	BinaryExpr(const L& l, const R& r) : lhs(l), rhs(r) {}
+	value_type operator[](size_t i) const { return Op::apply(lhs[i], rhs[i]); }
+
+	typename expr_ref<L>::type lhs;
+	typename expr_ref<R>::type rhs;
+};
+
+template <typename E>
+struct NegateExpr : VecExpr<NegateExpr<E>>
+{
+	typedef typename E::value_type value_type;
+	static constexpr size_t size() { return E::size(); }
+
+	explicit NegateExpr(const E& e) : expr(e) {}
+	value_type operator[](size_t i) const { return -expr[i]; }
+
+	typename expr_ref<E>::type expr;
+};
+
+} // namespace detail
+
+template <typename T, size_t N>
+class alignas(detail::vec_align<T, N>()) FixedVec : public VecExpr<FixedVec<T, N>>
+{
+	static_assert(N > 0, "FixedVec can not be empty");
+
+public:
+	typedef T value_type;
+	// 和std::array一样是函数；表达式类里也是size()，用E::size()取编译期长度
+	static constexpr size_t size() { return N; }
+
+	// 和内置数组一样，默认构造不初始化(算术类型)
+	FixedVec() = default;
+
+	explicit FixedVec(T fill)
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			m_data[i] = fill;
+		}
+	}
+
+	// 元素不够时后面补0
+	FixedVec(std::initializer_list<T> init)
+	{
+		size_t i = 0;
+		for (auto it = init.begin(); it != init.end() && i < N; ++it)
+		{
+			m_data[i++] = *it;
+		}
+		for (; i < N; i++)
+		{
+			m_data[i] = T();
+		}
+	}
+
+	// 表达式在这里才真正计算，一个循环写完所有元素
+	template <typename E>
+	FixedVec(const VecExpr<E>& expr)
+	{
+		assign(expr.self());
+	}
+
+	template <typename E>
+	FixedVec& operator=(const VecExpr<E>& expr)
+	{
+		assign(expr.self());
+		return *this;
+	}
+
+	template <typename E>
+	FixedVec& operator+=(const VecExpr<E>& expr) { return *this = *this + expr.self(); }
+	template <typename E>
+	FixedVec& operator-=(const VecExpr<E>& expr) { return *this = *this - expr.self(); }
+	template <typename E>
+	FixedVec& operator*=(const VecExpr<E>& expr) { return *this = *this * expr.self(); }
+	template <typename E>
+	FixedVec& operator/=(const VecExpr<E>& expr) { return *this = *this / expr.self(); }
+	// 标量的检查和二元运算符一样
+	template <typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+	FixedVec& operator+=(S s) { return *this = *this + s; }
+	template <typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+	FixedVec& operator-=(S s) { return *this = *this - s; }
+	template <typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+	FixedVec& operator*=(S s) { return *this = *this * s; }
+	template <typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type>
+	FixedVec& operator/=(S s) { return *this = *this / s; }
+
+	T& operator[](size_t i) { return m_data[i]; }
+	const T& operator[](size_t i) const { return m_data[i]; }
+
+	T* data() { return m_data; }
+	const T* data() const { return m_data; }
+	T* begin() { return m_data; }
+	T* end() { return m_data + N; }
+	const T* begin() const { return m_data; }
+	const T* end() const { return m_data + N; }
+
+private:
+	// 逐元素运算，下标相同的元素互不依赖，a = a + b这样的自赋值也是安全的
+	template <typename E>
+	void assign(const E& expr)
+	{
+		static_assert(E::size() == N, "FixedVec size mismatch");
+		for (size_t i = 0; i < N; i++)
+		{
+			m_data[i] = expr[i];
+		}
+	}
+
+private:
+	T m_data[N];
+};
+
+// 运算符：表达式和表达式，表达式和标量
+#define FIXED_VEC_BINARY_OPERATOR(op, name) \
+	template <typename L, typename R> \
+	detail::BinaryExpr<L, R, detail::name> operator op(const VecExpr<L>& l, const VecExpr<R>& r) \
+	{ \
+		return detail::BinaryExpr<L, R, detail::name>(l.self(), r.self()); \
+	} \
+	template <typename L, typename S, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type> \
+	detail::BinaryExpr<L, detail::ScalarExpr<typename L::value_type, L::size()>, detail::name> \
+	operator op(const VecExpr<L>& l, S s) \
+	{ \
+		static_assert(detail::scalar_fits<typename L::value_type, S>(), "scalar narrows to FixedVec element type"); \
+		typedef detail::ScalarExpr<typename L::value_type, L::size()> scalar; \
+		return detail::BinaryExpr<L, scalar, detail::name>(l.self(), scalar((typename L::value_type)s)); \
+	} \
+	template <typename S, typename R, typename = typename std::enable_if<std::is_arithmetic<S>::value>::type> \
+	detail::BinaryExpr<detail::ScalarExpr<typename R::value_type, R::size()>, R, detail::name> \
+	operator op(S s, const VecExpr<R>& r) \
+	{ \
+		static_assert(detail::scalar_fits<typename R::value_type, S>(), "scalar narrows to FixedVec element type"); \
+		typedef detail::ScalarExpr<typename R::value_type, R::size()> scalar; \
+		return detail::BinaryExpr<scalar, R, detail::name>(scalar((typename R::value_type)s), r.self()); \
+	}
+
+FIXED_VEC_BINARY_OPERATOR(+, add)
+FIXED_VEC_BINARY_OPERATOR(-, sub)
+FIXED_VEC_BINARY_OPERATOR(*, mul)
+FIXED_VEC_BINARY_OPERATOR(/, div)
+
+#undef FIXED_VEC_BINARY_OPERATOR
+
+template <typename E>
+detail::NegateExpr<E> operator-(const VecExpr<E>& e)
+{
+	return detail::NegateExpr<E>(e.self());
+}
+
+namespace detail{
+
+// 归约：Lanes>1时分Lanes路独立累加，打破循环间的依赖(浮点数不开-ffast-math时编译器不会自己重排)，
+// 每一步的Lanes次运算正好是一条SIMD指令；最后把各路合并
+template <typename E, typename Op>
+typename E::value_type reduce(const E& expr, Op op)
+{
+	typedef typename E::value_type T;
+	constexpr size_t N = E::size();
+	constexpr size_t Lanes = reduce_lanes<T, N>();
+	if constexpr (Lanes == 1)
+	{
+		T acc = expr[0];
+		for (size_t i = 1; i < N; i++)
+		{
+			acc = op(acc, expr[i]);
+		}
+		return acc;
+	}
+	else
+	{
+		T lanes[Lanes];
+		for (size_t k = 0; k < Lanes; k++)
+		{
+			lanes[k] = expr[k];
+		}
+		size_t i = Lanes;
+		for (; i + Lanes <= N; i += Lanes)
+		{
+			for (size_t k = 0; k < Lanes; k++)
+			{
+				lanes[k] = op(lanes[k], expr[i + k]);
+			}
+		}
+		T acc = lanes[0];
+		for (size_t k = 1; k < Lanes; k++)
+		{
+			acc = op(acc, lanes[k]);
+		}
+		for (; i < N; i++)
+		{
+			acc = op(acc, expr[i]);
+		}
+		return acc;
+	}
+}
+
+} // namespace detail
+
+// 归约可以直接作用在表达式上，比如sum(a * b)，同样不会生成临时向量
+template <typename E>
+typename E::value_type sum(const VecExpr<E>& e)
+{
+	typedef typename E::value_type T;
+	return detail::reduce(e.self(), [](T a, T b) { return a + b; });
+}
+
+template <typename L, typename R>
+typename L::value_type dot(const VecExpr<L>& l, const VecExpr<R>& r)
+{
+	return sum(l * r);
+}
+
+template <typename E>
+typename E::value_type min(const VecExpr<E>& e)
+{
+	typedef typename E::value_type T;
+	return detail::reduce(e.self(), [](T a, T b) { return b < a ? b : a; });
+}
+
+template <typename E>
+typename E::value_type max(const VecExpr<E>& e)
+{
+	typedef typename E::value_type T;
+	return detail::reduce(e.self(), [](T a, T b) { return a < b ? b : a; });
+}
+
+template <typename T, size_t N>
+bool operator==(const FixedVec<T, N>& a, const FixedVec<T, N>& b)
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		if (!(a[i] == b[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T, size_t N>
+bool operator!=(const FixedVec<T, N>& a, const FixedVec<T, N>& b)
+{
+	return !(a == b);
+}
+
+} // namespace vec
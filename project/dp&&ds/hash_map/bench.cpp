@@ -0,0 +1,121 @@
+// g++ bench.cpp -std=c++17 -O2 -pthread -o bench
+#include "concurrent_hash_map.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+using std::cout;
+using std::endl;
+
+// 对照组：std::unordered_map加一把互斥锁/读写锁
+template <typename Mutex>
+class locked_map
+{
+public:
+	bool find(uint64_t key, uint64_t& out) const
+	{
+		read_lock lock(m_mutex);
+		auto it = m_map.find(key);
+		if (it == m_map.end())
+		{
+			return false;
+		}
+		out = it->second;
+		return true;
+	}
+
+	void insert_or_assign(uint64_t key, uint64_t value)
+	{
+		std::lock_guard<Mutex> lock(m_mutex);
+		m_map[key] = value;
+	}
+
+private:
+	// shared_mutex读时拿共享锁，mutex只能拿独占锁
+	typedef typename std::conditional<std::is_same<Mutex, std::shared_mutex>::value,
+		std::shared_lock<Mutex>, std::unique_lock<Mutex>>::type read_lock;
+
+	mutable Mutex m_mutex;
+	std::unordered_map<uint64_t, uint64_t> m_map;
+};
+
+const uint64_t kKeys = 1 << 18;
+const size_t kOpsPerThread = 2000000;
+
+// 预先放入kKeys个key，每个线程做kOpsPerThread次操作，其中write_percent%是写，其余是查找(有一半查不到)
+template <typename Map>
+void bench(const char* name, int threads, int write_percent)
+{
+	Map map;
+	for (uint64_t k = 0; k < kKeys; k++)
+	{
+		map.insert_or_assign(k, k);
+	}
+
+	std::atomic<bool> start{false};
+	std::atomic<uint64_t> hits{0};
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&, t] {
+			std::mt19937_64 rng(t + 1);
+			std::vector<uint64_t> keys(kOpsPerThread);
+			for (uint64_t& key : keys)
+			{
+				key = rng() % (kKeys * 2);
+			}
+			while (!start.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			uint64_t found = 0;
+			for (size_t i = 0; i < kOpsPerThread; i++)
+			{
+				uint64_t key = keys[i];
+				if ((int)(key % 100) < write_percent)
+				{
+					map.insert_or_assign(key % kKeys, i);
+				}
+				else
+				{
+					uint64_t value;
+					found += map.find(key, value);
+				}
+			}
+			hits += found;
+		});
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	start.store(true, std::memory_order_release);
+	for (std::thread& t : workers)
+	{
+		t.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	cout << name << " threads=" << threads << " writes=" << write_percent << "%: "
+		<< kOpsPerThread * threads / seconds / 1e6 << " Mops/s (" << hits << ")" << endl;
+}
+
+int main()
+{
+	typedef conc::concurrent_hash_map<uint64_t, uint64_t> concurrent_map;
+	unsigned hw = std::thread::hardware_concurrency();
+	for (int write_percent : {0, 1, 10})
+	{
+		for (int threads : {1, 2, 4, 8})
+		{
+			bench<locked_map<std::mutex>>("unordered_map+mutex       ", threads, write_percent);
+			bench<locked_map<std::shared_mutex>>("unordered_map+shared_mutex", threads, write_percent);
+			bench<concurrent_map>("concurrent_hash_map       ", threads, write_percent);
+		}
+		cout << endl;
+	}
+	cout << "hardware_concurrency=" << hw << endl;
+	return 0;
+}
@@ -0,0 +1,480 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 读多写少的并发哈希表
+// 1. 按哈希值的高位分成若干shard，每个shard是一张独立的开放寻址表(Swiss table)：
+//    每个槽位有一个控制字节(空/删除/哈希值的低7位)，16个控制字节一组，一条SSE2比较就能找出组里所有候选槽位
+// 2. 写者拿shard的锁，修改前后各把shard的序号加1(seqlock)
+//    读者不拿锁：记下序号，探测，再检查序号没变；变了(或者是奇数，正在写)就重试
+// 3. 读者可能读到正在被修改的槽位，所以K和V必须能平凡拷贝(整数、指针、POD结构体)，
+//    大对象存指针或者下标；find把值拷贝出来，不返回引用
+namespace conc{
+
+namespace detail{
+
+const size_t kGroupSize = 16;
+
+// 控制字节：最高位为1表示不是有效元素
+const int8_t kEmpty = -128;   // 0x80
+const int8_t kDeleted = -2;   // 0xFE
+
+// std::hash对整数是恒等映射，先打散一下，shard和槽位分别用高位和低位
+inline uint64_t mix_hash(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// 一组16个控制字节，match返回等于h2的槽位的位掩码
+struct group
+{
+	explicit group(const int8_t* ctrl)
+	{
+#if defined(__SSE2__)
+		m_ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+		std::memcpy(m_ctrl, ctrl, kGroupSize);
+#endif
+	}
+
+	uint32_t match(int8_t h2) const
+	{
+#if defined(__SSE2__)
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(m_ctrl, _mm_set1_epi8(h2)));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < kGroupSize; i++)
+		{
+			mask |= (uint32_t)(m_ctrl[i] == h2) << i;
+		}
+		return mask;
+#endif
+	}
+
+	uint32_t match_empty() const { return match(kEmpty); }
+
+	// 空的或已删除的槽位(最高位为1)
+	uint32_t match_free() const
+	{
+#if defined(__SSE2__)
+		return (uint32_t)_mm_movemask_epi8(m_ctrl);
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < kGroupSize; i++)
+		{
+			mask |= (uint32_t)(m_ctrl[i] < 0) << i;
+		}
+		return mask;
+#endif
+	}
+
+#if defined(__SSE2__)
+	__m128i m_ctrl;
+#else
+	int8_t m_ctrl[kGroupSize];
+#endif
+};
+
+inline unsigned lowest_bit(uint32_t mask)
+{
+	return (unsigned)__builtin_ctz(mask);
+}
+
+} // namespace detail
+
+template <typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+class concurrent_hash_map
+{
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+		"optimistic readers copy slots that may be concurrently written, store pointers or ids instead");
+
+public:
+	// shard数向上取整到2的幂，一般取核数的几倍
+	explicit concurrent_hash_map(size_t shards = 64)
+	{
+		m_shard_bits = 0;
+		while (((size_t)1 << m_shard_bits) < shards)
+		{
+			m_shard_bits++;
+		}
+		m_shards = new shard[(size_t)1 << m_shard_bits];
+	}
+
+	~concurrent_hash_map()
+	{
+		delete[] m_shards;
+	}
+
+	concurrent_hash_map(const concurrent_hash_map&) = delete;
+	concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+	// 不拿锁；找到时把值拷贝到out
+	bool find(const K& key, V& out) const
+	{
+		uint64_t h = hash(key);
+		const shard& s = shard_of(h);
+		for (;;)
+		{
+			uint32_t seq = s.seq.load(std::memory_order_acquire);
+			if (seq & 1)
+			{
+				std::this_thread::yield();  // 写者在改，等它写完
+				continue;
+			}
+			const table* t = s.tab.load(std::memory_order_acquire);
+			bool found = false;
+			if (t != nullptr)
+			{
+				long index = t->find(key, h);
+				if (index >= 0)
+				{
+					std::memcpy(static_cast<void*>(&out), &t->slots[index].value, sizeof(V));
+					found = true;
+				}
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (s.seq.load(std::memory_order_relaxed) == seq)
+			{
+				return found;
+			}
+		}
+	}
+
+	bool contains(const K& key) const
+	{
+		V value;
+		return find(key, value);
+	}
+
+	// key不存在时插入，返回是否插入了
+	bool insert(const K& key, const V& value)
+	{
+		uint64_t h = hash(key);
+		shard& s = shard_of(h);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		table* t = s.tab.load(std::memory_order_relaxed);
+		if (t != nullptr && t->find(key, h) >= 0)
+		{
+			return false;
+		}
+		write_guard guard(s);
+		insert_new(s, key, value, h);
+		return true;
+	}
+
+	// key存在时覆盖，返回是否是新插入的
+	bool insert_or_assign(const K& key, const V& value)
+	{
+		uint64_t h = hash(key);
+		shard& s = shard_of(h);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		table* t = s.tab.load(std::memory_order_relaxed);
+		long index = t != nullptr ? t->find(key, h) : -1;
+		write_guard guard(s);
+		if (index >= 0)
+		{
+			t->slots[index].value = value;
+			return false;
+		}
+		insert_new(s, key, value, h);
+		return true;
+	}
+
+	// 在锁内原地修改值，f(V&)；key不存在时返回false
+	template <typename F>
+	bool update(const K& key, F f)
+	{
+		uint64_t h = hash(key);
+		shard& s = shard_of(h);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		table* t = s.tab.load(std::memory_order_relaxed);
+		long index = t != nullptr ? t->find(key, h) : -1;
+		if (index < 0)
+		{
+			return false;
+		}
+		write_guard guard(s);
+		f(t->slots[index].value);
+		return true;
+	}
+
+	bool erase(const K& key)
+	{
+		uint64_t h = hash(key);
+		shard& s = shard_of(h);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		table* t = s.tab.load(std::memory_order_relaxed);
+		long index = t != nullptr ? t->find(key, h) : -1;
+		if (index < 0)
+		{
+			return false;
+		}
+		write_guard guard(s);
+		t->erase(index);
+		s.size.store(s.size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// 各shard大小之和，有并发写时是近似值
+	size_t size() const
+	{
+		size_t n = 0;
+		for (size_t i = 0; i < shard_count(); i++)
+		{
+			n += m_shards[i].size.load(std::memory_order_relaxed);
+		}
+		return n;
+	}
+
+	bool empty() const { return size() == 0; }
+
+	size_t shard_count() const { return (size_t)1 << m_shard_bits; }
+
+	// 逐个shard加锁遍历，f(const K&, const V&)
+	template <typename F>
+	void for_each(F f) const
+	{
+		for (size_t i = 0; i < shard_count(); i++)
+		{
+			shard& s = m_shards[i];
+			std::lock_guard<std::mutex> lock(s.mutex);
+			const table* t = s.tab.load(std::memory_order_relaxed);
+			if (t == nullptr)
+			{
+				continue;
+			}
+			for (size_t k = 0; k < t->capacity; k++)
+			{
+				if (t->ctrl[k] >= 0)
+				{
+					f(t->slots[k].key, t->slots[k].value);
+				}
+			}
+		}
+	}
+
+private:
+	struct slot
+	{
+		K key;
+		V value;
+	};
+
+	// 一张Swiss table，容量是组大小的2的幂倍
+	// 探测以组为单位：从h1对应的组开始，按1, 2, 3...的步长跳(三角数探测，能走遍所有组)，
+	// 遇到含空槽位的组就说明key不存在
+	struct table
+	{
+		explicit table(size_t cap)
+			: capacity(cap),
+			  group_mask(cap / detail::kGroupSize - 1),
+			  ctrl(static_cast<int8_t*>(::operator new(cap, std::align_val_t(detail::kGroupSize)))),
+			  slots(static_cast<slot*>(::operator new(sizeof(slot) * cap)))
+		{
+			std::memset(ctrl, detail::kEmpty, cap);
+		}
+
+		~table()
+		{
+			::operator delete(ctrl, std::align_val_t(detail::kGroupSize));
+			::operator delete(slots);
+		}
+
+		table(const table&) = delete;
+		table& operator=(const table&) = delete;
+
+		// 返回槽位下标，没找到返回-1
+		// 读者调用时表可能正在被修改，所以探测的组数有上限，读到的半新半旧的数据由seqlock检查丢弃
+		long find(const K& key, uint64_t h) const
+		{
+			int8_t h2 = (int8_t)(h & 0x7f);
+			size_t g = (size_t)(h >> 7) & group_mask;
+			for (size_t step = 0; step <= group_mask; step++)
+			{
+				const int8_t* base = ctrl + g * detail::kGroupSize;
+				detail::group grp(base);
+				for (uint32_t mask = grp.match(h2); mask != 0; mask &= mask - 1)
+				{
+					size_t index = g * detail::kGroupSize + detail::lowest_bit(mask);
+					K candidate;
+					std::memcpy(static_cast<void*>(&candidate), &slots[index].key, sizeof(K));
+					if (Equal()(candidate, key))
+					{
+						return (long)index;
+					}
+				}
+				if (grp.match_empty() != 0)
+				{
+					return -1;
+				}
+				g = (g + step + 1) & group_mask;
+			}
+			return -1;
+		}
+
+		// 调用者保证key不存在并且还有空位；删除标记的槽位可以复用
+		void insert(const K& key, const V& value, uint64_t h)
+		{
+			size_t g = (size_t)(h >> 7) & group_mask;
+			for (size_t step = 0;; step++)
+			{
+				uint32_t mask = detail::group(ctrl + g * detail::kGroupSize).match_free();
+				if (mask != 0)
+				{
+					size_t index = g * detail::kGroupSize + detail::lowest_bit(mask);
+					if (ctrl[index] == detail::kEmpty)
+					{
+						used++;
+					}
+					slots[index].key = key;
+					slots[index].value = value;
+					ctrl[index] = (int8_t)(h & 0x7f);
+					return;
+				}
+				g = (g + step + 1) & group_mask;
+			}
+		}
+
+		// 所在组里还有空槽位时，没有探测会越过这个组，可以直接标成空；否则标成删除
+		void erase(size_t index)
+		{
+			size_t g = index / detail::kGroupSize;
+			if (detail::group(ctrl + g * detail::kGroupSize).match_empty() != 0)
+			{
+				ctrl[index] = detail::kEmpty;
+				used--;
+			}
+			else
+			{
+				ctrl[index] = detail::kDeleted;
+			}
+		}
+
+		size_t capacity;
+		size_t group_mask;
+		size_t used = 0;  // 有效元素加删除标记，决定什么时候重建
+		int8_t* ctrl;
+		slot* slots;
+	};
+
+	// 独占cache line，避免相邻shard的序号互相干扰
+	struct alignas(64) shard
+	{
+		~shard()
+		{
+			delete tab.load(std::memory_order_relaxed);
+			for (table* t : retired)
+			{
+				delete t;
+			}
+		}
+
+		std::atomic<uint32_t> seq{0};
+		std::atomic<table*> tab{nullptr};
+		std::atomic<size_t> size{0};
+		std::mutex mutex;
+		// 扩容换下来的旧表：可能还有读者在上面探测，留到整个map析构时才释放
+		// 只有翻倍时才换表，旧表加起来不超过当前表的大小
+		std::vector<table*> retired;
+	};
+
+	// 持有shard锁时使用，修改期间序号为奇数
+	class write_guard
+	{
+	public:
+		explicit write_guard(shard& s) : m_shard(s)
+		{
+			uint32_t seq = s.seq.load(std::memory_order_relaxed);
+			s.seq.store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		~write_guard()
+		{
+			m_shard.seq.store(m_shard.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		write_guard(const write_guard&) = delete;
+		write_guard& operator=(const write_guard&) = delete;
+
+	private:
+		shard& m_shard;
+	};
+
+	uint64_t hash(const K& key) const
+	{
+		return detail::mix_hash((uint64_t)Hash()(key));
+	}
+
+	shard& shard_of(uint64_t h) const
+	{
+		return m_shards[m_shard_bits == 0 ? 0 : (size_t)(h >> (64 - m_shard_bits))];
+	}
+
+	// 负载(含删除标记)到7/8时重建：元素多就换一张两倍大的表，删除标记多就原地重建
+	void insert_new(shard& s, const K& key, const V& value, uint64_t h)
+	{
+		table* t = s.tab.load(std::memory_order_relaxed);
+		size_t size = s.size.load(std::memory_order_relaxed);
+		if (t == nullptr)
+		{
+			t = new table(detail::kGroupSize);
+			s.tab.store(t, std::memory_order_release);
+		}
+		else if (t->used + 1 > t->capacity / 8 * 7)
+		{
+			if (size + 1 > t->capacity / 2)
+			{
+				table* bigger = new table(t->capacity * 2);
+				rehash(*t, *bigger);
+				s.retired.push_back(t);
+				s.tab.store(bigger, std::memory_order_release);
+				t = bigger;
+			}
+			else
+			{
+				// 同样大小的表原地覆盖，不产生旧表；读者看到的中间状态会被序号检查丢弃
+				table tmp(t->capacity);
+				rehash(*t, tmp);
+				std::memcpy(t->ctrl, tmp.ctrl, t->capacity);
+				std::memcpy(static_cast<void*>(t->slots), tmp.slots, sizeof(slot) * t->capacity);
+				t->used = tmp.used;
+			}
+		}
+		t->insert(key, value, h);
+		s.size.store(size + 1, std::memory_order_relaxed);
+	}
+
+	void rehash(const table& from, table& to) const
+	{
+		for (size_t i = 0; i < from.capacity; i++)
+		{
+			if (from.ctrl[i] >= 0)
+			{
+				to.insert(from.slots[i].key, from.slots[i].value, hash(from.slots[i].key));
+			}
+		}
+	}
+
+private:
+	shard* m_shards;
+	unsigned m_shard_bits;
+};
+
+} // namespace conc
@@ -0,0 +1,215 @@
+// g++ bench.cpp -std=c++17 -O2 -pthread -o bench
+#include "bounded_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::cout;
+using std::endl;
+
+// 对照组：std::deque加一把锁，同样有容量上限
+template <typename T>
+class mutex_deque
+{
+public:
+	explicit mutex_deque(size_t capacity) : m_capacity(capacity) {}
+
+	bool try_push(T value)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_items.size() >= m_capacity)
+		{
+			return false;
+		}
+		m_items.push_back(value);
+		return true;
+	}
+
+	bool try_pop(T& out)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_items.empty())
+		{
+			return false;
+		}
+		out = m_items.front();
+		m_items.pop_front();
+		return true;
+	}
+
+	template <typename It>
+	size_t try_push_n(It first, size_t n)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t k = std::min(n, m_capacity - m_items.size());
+		m_items.insert(m_items.end(), first, first + k);
+		return k;
+	}
+
+	template <typename OutIt>
+	size_t try_pop_n(OutIt out, size_t n)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t k = std::min(n, m_items.size());
+		std::copy(m_items.begin(), m_items.begin() + k, out);
+		m_items.erase(m_items.begin(), m_items.begin() + k);
+		return k;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::deque<T> m_items;
+	size_t m_capacity;
+};
+
+const size_t kCapacity = 4096;
+const size_t kItems = 2000000;
+const size_t kBatch = 32;
+const size_t kSampleEvery = 16;  // 每16个元素记一次延迟
+
+uint64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 元素就是入队时刻，出队时算出排队延迟
+// batch为0时逐个push/pop，否则用try_push_n/try_pop_n
+template <typename Queue>
+void bench(const char* name, int producers, int consumers, size_t batch)
+{
+	Queue queue(kCapacity);
+	std::atomic<size_t> consumed{0};
+	std::atomic<bool> start{false};
+	std::vector<std::vector<uint64_t>> latency(consumers);
+	std::vector<std::thread> threads;
+
+	for (int p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&, p] {
+			size_t count = kItems / producers + (p < (int)(kItems % producers) ? 1 : 0);
+			while (!start.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			std::vector<uint64_t> items(kBatch);
+			while (count != 0)
+			{
+				if (batch == 0)
+				{
+					if (!queue.try_push(now_ns()))
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					count--;
+				}
+				else
+				{
+					size_t n = std::min(batch, count);
+					uint64_t t = now_ns();
+					std::fill(items.begin(), items.begin() + n, t);
+					size_t pushed = 0;
+					while (pushed < n)
+					{
+						size_t k = queue.try_push_n(items.begin() + pushed, n - pushed);
+						if (k == 0)
+						{
+							std::this_thread::yield();
+						}
+						pushed += k;
+					}
+					count -= n;
+				}
+			}
+		});
+	}
+
+	for (int c = 0; c < consumers; c++)
+	{
+		threads.emplace_back([&, c] {
+			std::vector<uint64_t>& samples = latency[c];
+			samples.reserve(kItems / kSampleEvery / consumers + 1);
+			std::vector<uint64_t> items(kBatch);
+			size_t seen = 0;
+			while (!start.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			while (consumed.load(std::memory_order_relaxed) < kItems)
+			{
+				size_t k = 0;
+				if (batch == 0)
+				{
+					k = queue.try_pop(items[0]) ? 1 : 0;
+				}
+				else
+				{
+					k = queue.try_pop_n(items.begin(), batch);
+				}
+				if (k == 0)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+				uint64_t t = now_ns();
+				for (size_t i = 0; i < k; i++)
+				{
+					if (seen++ % kSampleEvery == 0)
+					{
+						samples.push_back(t - items[i]);
+					}
+				}
+				consumed.fetch_add(k, std::memory_order_relaxed);
+			}
+		});
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	start.store(true, std::memory_order_release);
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	std::vector<uint64_t> all;
+	for (const std::vector<uint64_t>& samples : latency)
+	{
+		all.insert(all.end(), samples.begin(), samples.end());
+	}
+	std::sort(all.begin(), all.end());
+	auto percentile = [&all](double p) { return all.empty() ? 0 : all[(size_t)(p * (all.size() - 1))]; };
+
+	cout << name << " " << producers << "P/" << consumers << "C"
+		<< (batch == 0 ? "" : " batch") << ": "
+		<< kItems / seconds / 1e6 << " Mops/s"
+		<< " p50=" << percentile(0.5) << "ns"
+		<< " p99=" << percentile(0.99) << "ns"
+		<< " p999=" << percentile(0.999) << "ns" << endl;
+}
+
+int main()
+{
+	const int configs[][2] = {{1, 1}, {1, 4}, {4, 1}, {2, 2}, {4, 4}, {8, 8}};
+	for (const int* config : configs)
+	{
+		int p = config[0], c = config[1];
+		bench<mutex_deque<uint64_t>>("mutex+deque", p, c, 0);
+		bench<lockfree::mpmc_queue<uint64_t>>("mpmc_queue ", p, c, 0);
+		bench<mutex_deque<uint64_t>>("mutex+deque", p, c, kBatch);
+		bench<lockfree::mpmc_queue<uint64_t>>("mpmc_queue ", p, c, kBatch);
+		if (p == 1 && c == 1)
+		{
+			bench<lockfree::spsc_queue<uint64_t>>("spsc_queue ", p, c, 0);
+			bench<lockfree::spsc_queue<uint64_t>>("spsc_queue ", p, c, kBatch);
+		}
+		cout << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lockfree{
+
+// 有界环形队列，容量向上取整到2的幂，满了push失败、空了pop失败，都不阻塞
+// mpmc：任意多个生产者和消费者
+// spsc：只有一个生产者线程和一个消费者线程，只需要load/store，没有CAS
+enum class queue_mode
+{
+	mpmc,
+	spsc
+};
+
+namespace detail{
+
+const size_t kCacheLine = 64;
+
+inline size_t round_capacity(size_t capacity)
+{
+	if (capacity < 2)
+	{
+		capacity = 2;
+	}
+	size_t n = 1;
+	while (n < capacity)
+	{
+		n <<= 1;
+	}
+	return n;
+}
+
+// 独占一条cache line的下标，生产者和消费者的下标不会伪共享
+struct alignas(kCacheLine) padded_index
+{
+	std::atomic<size_t> value{0};
+};
+
+} // namespace detail
+
+// MPMC：每个槽位带一个序号(Dmitry Vyukov的做法)
+// 槽位i的序号 == pos 表示第pos次push可以写它；== pos + 1 表示第pos次push写完了，第pos次pop可以读
+// pop读完后把序号设成pos + capacity，留给下一圈的push
+// 生产者只争用tail，消费者只争用head，生产者和消费者之间只通过各自槽位的序号同步
+// CAS占下槽位之后就必须发布序号，否则后面到这个槽位的线程永远看到满/空，
+// 所以占槽位之后的构造和移动都不能抛异常
+template <typename T, queue_mode Mode = queue_mode::mpmc>
+class bounded_queue
+{
+	static_assert(std::is_nothrow_move_constructible<T>::value, "mpmc queue element must be nothrow move constructible");
+	static_assert(std::is_nothrow_move_assignable<T>::value, "mpmc queue element must be nothrow move assignable");
+
+public:
+	explicit bounded_queue(size_t capacity)
+		: m_mask(detail::round_capacity(capacity) - 1),
+		  m_slots(static_cast<slot*>(::operator new(sizeof(slot) * (m_mask + 1), std::align_val_t(alignof(slot)))))
+	{
+		for (size_t i = 0; i <= m_mask; i++)
+		{
+			::new (&m_slots[i]) slot();
+			m_slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// 析构时不能再有其他线程在用，剩下的元素就是[head, tail)
+	~bounded_queue()
+	{
+		size_t head = m_head.value.load(std::memory_order_relaxed);
+		size_t tail = m_tail.value.load(std::memory_order_relaxed);
+		for (; head != tail; head++)
+		{
+			reinterpret_cast<T*>(m_slots[head & m_mask].storage)->~T();
+		}
+		for (size_t i = 0; i <= m_mask; i++)
+		{
+			m_slots[i].~slot();
+		}
+		::operator delete(m_slots, std::align_val_t(alignof(slot)));
+	}
+
+	bounded_queue(const bounded_queue&) = delete;
+	bounded_queue& operator=(const bounded_queue&) = delete;
+
+	size_t capacity() const { return m_mask + 1; }
+
+	// 可能抛异常的构造先在CAS之前构造到临时对象里，再移动进槽位(这时即使队列满了，参数也已经被用掉)
+	template <typename... Args>
+	bool try_emplace(Args&&... args)
+	{
+		if constexpr (!std::is_nothrow_constructible<T, Args&&...>::value)
+		{
+			T value(std::forward<Args>(args)...);
+			return try_emplace(std::move(value));
+		}
+		size_t pos = m_tail.value.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			slot& s = m_slots[pos & m_mask];
+			size_t seq = s.seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0)
+			{
+				if (m_tail.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					::new (s.storage) T(std::forward<Args>(args)...);
+					s.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;  //满了
+			}
+			else
+			{
+				pos = m_tail.value.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool try_push(const T& value) { return try_emplace(value); }
+	bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+	bool try_pop(T& out)
+	{
+		size_t pos = m_head.value.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			slot& s = m_slots[pos & m_mask];
+			size_t seq = s.seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (m_head.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					take(s, pos, out);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;  //空了
+			}
+			else
+			{
+				pos = m_head.value.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// 批量push：一次CAS占下连续的k个槽位，返回实际放进去的个数(0到n)
+	// 从first开始按顺序移动元素，没放进去的保持原样
+	template <typename It>
+	size_t try_push_n(It first, size_t n)
+	{
+		static_assert(std::is_nothrow_constructible<T, decltype(std::move(*first))>::value,
+			"mpmc queue element must be nothrow constructible from *first");
+		if (n == 0)
+		{
+			return 0;
+		}
+		size_t pos = m_tail.value.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			size_t k = ready_count(pos, n, 0);
+			if (k == 0)
+			{
+				//第一个槽位都不能用：满了，或者tail已经被别人推进了
+				if ((intptr_t)m_slots[pos & m_mask].seq.load(std::memory_order_acquire) - (intptr_t)pos < 0)
+				{
+					return 0;
+				}
+				pos = m_tail.value.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (m_tail.value.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+			{
+				for (size_t i = 0; i < k; i++, ++first)
+				{
+					slot& s = m_slots[(pos + i) & m_mask];
+					::new (s.storage) T(std::move(*first));
+					s.seq.store(pos + i + 1, std::memory_order_release);
+				}
+				return k;
+			}
+		}
+	}
+
+	// 批量pop：最多取n个，按顺序写到out，返回取到的个数
+	template <typename OutIt>
+	size_t try_pop_n(OutIt out, size_t n)
+	{
+		static_assert(noexcept(*out = std::move(std::declval<T&>())), "assigning to *out must not throw");
+		if (n == 0)
+		{
+			return 0;
+		}
+		size_t pos = m_head.value.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			size_t k = ready_count(pos, n, 1);
+			if (k == 0)
+			{
+				if ((intptr_t)m_slots[pos & m_mask].seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1) < 0)
+				{
+					return 0;
+				}
+				pos = m_head.value.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (m_head.value.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+			{
+				for (size_t i = 0; i < k; i++, ++out)
+				{
+					take(m_slots[(pos + i) & m_mask], pos + i, *out);
+				}
+				return k;
+			}
+		}
+	}
+
+	// 近似值，其他线程同时在操作时只能参考
+	size_t size_approx() const
+	{
+		size_t tail = m_tail.value.load(std::memory_order_relaxed);
+		size_t head = m_head.value.load(std::memory_order_relaxed);
+		return tail > head ? tail - head : 0;
+	}
+
+private:
+	struct slot
+	{
+		std::atomic<size_t> seq{0};
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	// 从pos开始连续有几个槽位的序号等于pos + i + offset(最多n个，不超过容量)
+	size_t ready_count(size_t pos, size_t n, size_t offset) const
+	{
+		if (n > m_mask + 1)
+		{
+			n = m_mask + 1;
+		}
+		size_t k = 0;
+		while (k < n && m_slots[(pos + k) & m_mask].seq.load(std::memory_order_acquire) == pos + k + offset)
+		{
+			k++;
+		}
+		return k;
+	}
+
+	// 移出元素后把槽位交给下一圈的push
+	template <typename Out>
+	void take(slot& s, size_t pos, Out&& out)
+	{
+		T* value = reinterpret_cast<T*>(s.storage);
+		out = std::move(*value);
+		value->~T();
+		s.seq.store(pos + m_mask + 1, std::memory_order_release);
+	}
+
+private:
+	detail::padded_index m_head;   //消费者
+	detail::padded_index m_tail;   //生产者
+	const size_t m_mask;
+	slot* m_slots;
+};
+
+// SPSC：head只有消费者写，tail只有生产者写，不需要CAS和槽位序号
+// 双方各自缓存一份对方的下标，只有看起来满了/空了才去读对方的cache line
+template <typename T>
+class bounded_queue<T, queue_mode::spsc>
+{
+public:
+	explicit bounded_queue(size_t capacity)
+		: m_mask(detail::round_capacity(capacity) - 1),
+		  m_buffer(static_cast<T*>(::operator new(sizeof(T) * (m_mask + 1), std::align_val_t(alignof(T)))))
+	{
+	}
+
+	~bounded_queue()
+	{
+		size_t head = m_head.value.load(std::memory_order_relaxed);
+		size_t tail = m_tail.value.load(std::memory_order_relaxed);
+		for (; head != tail; head++)
+		{
+			m_buffer[head & m_mask].~T();
+		}
+		::operator delete(m_buffer, std::align_val_t(alignof(T)));
+	}
+
+	bounded_queue(const bounded_queue&) = delete;
+	bounded_queue& operator=(const bounded_queue&) = delete;
+
+	size_t capacity() const { return m_mask + 1; }
+
+	// 只能在生产者线程调用
+	template <typename... Args>
+	bool try_emplace(Args&&... args)
+	{
+		size_t tail = m_tail.value.load(std::memory_order_relaxed);
+		if (tail - m_producer.cached_head > m_mask)
+		{
+			m_producer.cached_head = m_head.value.load(std::memory_order_acquire);
+			if (tail - m_producer.cached_head > m_mask)
+			{
+				return false;
+			}
+		}
+		::new (&m_buffer[tail & m_mask]) T(std::forward<Args>(args)...);
+		m_tail.value.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool try_push(const T& value) { return try_emplace(value); }
+	bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+	// 只能在消费者线程调用
+	bool try_pop(T& out)
+	{
+		size_t head = m_head.value.load(std::memory_order_relaxed);
+		if (head == m_consumer.cached_tail)
+		{
+			m_consumer.cached_tail = m_tail.value.load(std::memory_order_acquire);
+			if (head == m_consumer.cached_tail)
+			{
+				return false;
+			}
+		}
+		T& value = m_buffer[head & m_mask];
+		out = std::move(value);
+		value.~T();
+		m_head.value.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 批量版本只发布一次下标
+	template <typename It>
+	size_t try_push_n(It first, size_t n)
+	{
+		size_t tail = m_tail.value.load(std::memory_order_relaxed);
+		size_t free = m_mask + 1 - (tail - m_producer.cached_head);
+		if (free < n)
+		{
+			m_producer.cached_head = m_head.value.load(std::memory_order_acquire);
+			free = m_mask + 1 - (tail - m_producer.cached_head);
+		}
+		size_t k = n < free ? n : free;
+		for (size_t i = 0; i < k; i++, ++first)
+		{
+			::new (&m_buffer[(tail + i) & m_mask]) T(std::move(*first));
+		}
+		if (k != 0)
+		{
+			m_tail.value.store(tail + k, std::memory_order_release);
+		}
+		return k;
+	}
+
+	template <typename OutIt>
+	size_t try_pop_n(OutIt out, size_t n)
+	{
+		size_t head = m_head.value.load(std::memory_order_relaxed);
+		size_t avail = m_consumer.cached_tail - head;
+		if (avail < n)
+		{
+			m_consumer.cached_tail = m_tail.value.load(std::memory_order_acquire);
+			avail = m_consumer.cached_tail - head;
+		}
+		size_t k = n < avail ? n : avail;
+		for (size_t i = 0; i < k; i++, ++out)
+		{
+			T& value = m_buffer[(head + i) & m_mask];
+			*out = std::move(value);
+			value.~T();
+		}
+		if (k != 0)
+		{
+			m_head.value.store(head + k, std::memory_order_release);
+		}
+		return k;
+	}
+
+	size_t size_approx() const
+	{
+		return m_tail.value.load(std::memory_order_relaxed) - m_head.value.load(std::memory_order_relaxed);
+	}
+
+private:
+	detail::padded_index m_head;
+	detail::padded_index m_tail;
+	// 生产者和消费者各自的私有缓存，也分开放
+	struct alignas(detail::kCacheLine) { size_t cached_head = 0; } m_producer;
+	struct alignas(detail::kCacheLine) { size_t cached_tail = 0; } m_consumer;
+	const size_t m_mask;
+	T* m_buffer;
+};
+
+template <typename T>
+using mpmc_queue = bounded_queue<T, queue_mode::mpmc>;
+template <typename T>
+using spsc_queue = bounded_queue<T, queue_mode::spsc>;
+
+} // namespace lockfree
@@ -11,7 +11,8 @@ class A{
 private:
     A() : a_name("A"){};
     A(const A&);
-    ~A();
+    //由Singleton在shutdown时delete，需要定义
+    ~A(){}
     A& operator=(const A&);
 
 private:
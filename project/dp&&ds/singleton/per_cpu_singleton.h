@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <sched.h>
+#include <unistd.h>
+
+//每个CPU核一份实例的单例
+//和ThreadLocalSingleton相比，实例个数固定为核数，线程再多也不会增加内存和汇总开销
+//线程随时可能被调度到别的核上，所以同一份实例可能被多个线程同时访问，
+//T的修改必须是原子的(通常用relaxed的atomic)，好处是同一时刻基本只有一个核在写它，cache line不会来回跳
+namespace single{
+
+template <typename T>
+class PerCpuSingleton{
+public:
+    //当前线程所在核的实例
+    static T* instance(){
+        Slots* slots = slots_.load(std::memory_order_acquire);
+        if(slots == nullptr){
+            slots = create();
+        }
+        int cpu = sched_getcpu();
+        if(cpu < 0){
+            cpu = 0;
+        }
+        return &slots->slots[(unsigned)cpu % slots->count].value;
+    }
+
+    static int cpu_count(){
+        return instance_slots()->count;
+    }
+
+    //第cpu个核的实例
+    static T* instance(int cpu){
+        Slots* slots = instance_slots();
+        return &slots->slots[(unsigned)cpu % slots->count].value;
+    }
+
+    //遍历所有核的实例，其他核可能同时在改
+    template <typename F>
+    static void visit(F func){
+        Slots* slots = instance_slots();
+        for(int i = 0; i < slots->count; i++){
+            func(slots->slots[i].value);
+        }
+    }
+
+    //acc = func(acc, 每个实例)
+    template <typename R, typename F>
+    static R aggregate(R init, F func){
+        visit([&](const T& value){ init = func(init, value); });
+        return init;
+    }
+
+private:
+    PerCpuSingleton();
+
+    //每个实例独占cache line
+    struct alignas(64) Slot{
+        T value{};
+    };
+
+    struct Slots{
+        int count;
+        Slot* slots;
+    };
+
+    static Slots* instance_slots(){
+        Slots* slots = slots_.load(std::memory_order_acquire);
+        return slots != nullptr ? slots : create();
+    }
+
+    //和Singleton一样double check，核数按配置的CPU数(包括离线的)，保证sched_getcpu不会越界
+    //进程内一直使用，不释放
+    static Slots* create(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slots* slots = slots_.load(std::memory_order_relaxed);
+        if(slots == nullptr){
+            long count = sysconf(_SC_NPROCESSORS_CONF);
+            if(count < 1){
+                count = 1;
+            }
+            slots = new Slots();
+            slots->count = (int)count;
+            slots->slots = new Slot[count];
+            slots_.store(slots, std::memory_order_release);
+        }
+        return slots;
+    }
+
+private:
+    static std::atomic<Slots*> slots_;
+    static std::mutex mutex_;
+};
+
+template <typename T>
+std::atomic<typename PerCpuSingleton<T>::Slots*> PerCpuSingleton<T>::slots_{nullptr};
+
+template <typename T>
+std::mutex PerCpuSingleton<T>::mutex_;
+
+} // namespace single
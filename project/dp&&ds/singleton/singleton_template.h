@@ -1,19 +1,87 @@
 #pragma once
 #include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
 
 //抽象出单例模板
 namespace single{
 
+namespace detail{
+//按创建顺序记录所有单例的销毁函数，退出时逆序销毁
+//后创建的单例可能依赖先创建的(比如ClassFactory里打日志)，所以要先销毁
+//销毁过程中(析构函数里)或者退出处理已经跑过之后新建的单例也会被销毁：
+//run()一直处理到列表为空，atexit处理函数执行后再有单例创建时重新注册一次
+class ShutdownRegistry{
+public:
+    static ShutdownRegistry& instance(){
+        //故意不释放，保证任何静态对象析构时都还能用
+        static ShutdownRegistry* registry = new ShutdownRegistry();
+        return *registry;
+    }
+
+    void add(void (*destroy)()){
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(!registered_){
+            registered_ = true;
+            //退出处理过程中注册的函数也会被调用
+            std::atexit(&ShutdownRegistry::at_exit);
+        }
+        destroys_.push_back(destroy);
+    }
+
+    void run(){
+        for(;;){
+            std::vector<void (*)()> destroys;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                destroys.swap(destroys_);
+            }
+            if(destroys.empty()){
+                return;
+            }
+            for(auto it = destroys.rbegin(); it != destroys.rend(); ++it){
+                (*it)();
+            }
+        }
+    }
+
+private:
+    static void at_exit(){
+        ShutdownRegistry& registry = instance();
+        {
+            //这次的处理函数已经在执行，之后创建的单例要重新注册atexit
+            std::lock_guard<std::mutex> lock(registry.mutex_);
+            registry.registered_ = false;
+        }
+        registry.run();
+    }
+
+    std::mutex mutex_;
+    std::vector<void (*)()> destroys_;
+    bool registered_ = false;  //有一个还没执行的at_exit
+};
+} // namespace detail
+
+//按创建的逆序销毁所有单例，可以重复调用
+//进程退出时会自动调用一次，需要更早(比如在main返回前)确定地释放资源时手动调用
+//调用时不能有其他线程还在使用单例，之后再调用instance()会重新创建
+inline void shutdown(){
+    detail::ShutdownRegistry::instance().run();
+}
+
 template <typename T>
 class Singleton{
 public:
+    //快路径只有一次acquire读，没有锁也没有局部静态变量的guard检查
+    //第一次创建走慢路径：加锁后再检查一次(double check)
     static T* instance(){
-        //为保证线程安全
-        //这里需要加锁和double check
-        if(instance_ == NULL){
-            instance_ = new T();
+        T* instance = instance_.load(std::memory_order_acquire);
+        if(instance == nullptr){
+            instance = create();
         }
-        return instance_;
+        return instance;
     }
 private:
     Singleton(){};
@@ -21,14 +89,40 @@ private:
     ~Singleton();
     Singleton<T>& operator=(const Singleton<T>&);
 
+    static T* create(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        T* instance = instance_.load(std::memory_order_relaxed);
+        if(instance == nullptr){
+            instance = new T();
+            //release保证其他线程读到指针时，构造函数里的写入都可见
+            instance_.store(instance, std::memory_order_release);
+            detail::ShutdownRegistry::instance().add(&Singleton<T>::destroy);
+        }
+        return instance;
+    }
+
+    //只在取下指针时加锁，和create()互斥；析构在锁外进行：T的析构函数里可能还会用到别的单例甚至自己
+    static void destroy(){
+        T* instance;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            instance = instance_.exchange(nullptr, std::memory_order_acq_rel);
+        }
+        delete instance;
+    }
+
 private:
-    static T* instance_;
+    //atomic和mutex都是constexpr构造，属于常量初始化，不依赖静态初始化顺序
+    static std::atomic<T*> instance_;
+    static std::mutex mutex_;
 
 };
 //模板类的静态成员赋值写法
 //是不是给每一个T类都会编译出一句这个赋值语句
 template <typename T>
-T* Singleton<T>::instance_ = NULL;
+std::atomic<T*> Singleton<T>::instance_{nullptr};
 
-} // namespace single
+template <typename T>
+std::mutex Singleton<T>::mutex_;
 
+} // namespace single
@@ -0,0 +1,93 @@
+// g++ thread_local_main.cc -std=c++17 -O2 -pthread -o thread_local_main
+//ThreadLocalSingleton和PerCpuSingleton的用法：
+//多个线程各自计数，最后汇总；以及线程退出后槽位复用时保留/清空数据的区别
+
+#include "thread_local_singleton.h"
+#include "per_cpu_singleton.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace single;
+
+//visit时其他线程可能还在改，计数用relaxed的atomic
+struct Counter{
+    std::atomic<long> value{0};
+};
+
+//线程私有的缓冲区，不应该被下一个线程看到
+struct Scratch{
+    std::string owner;
+};
+
+struct ReusedCounter{
+    long value = 0;
+};
+
+const int kThreads = 4;
+const int kOps = 100000;
+
+template <typename F>
+void run_threads(int n, F func){
+    std::vector<std::thread> threads;
+    for(int t = 0; t < n; t++){
+        threads.emplace_back(func, t);
+    }
+    for(std::thread& thread : threads){
+        thread.join();
+    }
+}
+
+long sum(const Counter& counter){
+    return counter.value.load(std::memory_order_relaxed);
+}
+
+int main(){
+    //每个线程只改自己的实例，汇总时遍历所有线程(包括已退出的)
+    run_threads(kThreads, [](int){
+        for(int i = 0; i < kOps; i++){
+            ThreadLocalSingleton<Counter>::instance()->value.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    long total = ThreadLocalSingleton<Counter>::aggregate(0L, [](long acc, const Counter& c){ return acc + sum(c); });
+    assert(total == (long)kThreads * kOps);
+    std::cout << "ThreadLocalSingleton total=" << total << std::endl;
+
+    //默认保留数据：一个一个起线程，后面的线程复用前面退出线程的槽位，计数接着累加
+    for(int t = 0; t < 3; t++){
+        std::thread([]{ ThreadLocalSingleton<ReusedCounter>::instance()->value += 10; }).join();
+    }
+    int slots = 0;
+    ThreadLocalSingleton<ReusedCounter>::visit([&](const ReusedCounter& c){
+        slots++;
+        std::cout << "KeepOnReuse slot value=" << c.value << std::endl;
+    });
+    assert(slots == 1);
+    assert((ThreadLocalSingleton<ReusedCounter>::aggregate(0L, [](long acc, const ReusedCounter& c){ return acc + c.value; }) == 30));
+
+    //ResetOnReuse：新线程拿到的是清空过的实例
+    for(int t = 0; t < 3; t++){
+        std::thread([t]{
+            Scratch* scratch = ThreadLocalSingleton<Scratch, ResetOnReuse>::instance();
+            assert(scratch->owner.empty());
+            scratch->owner = "thread " + std::to_string(t);
+        }).join();
+    }
+    ThreadLocalSingleton<Scratch, ResetOnReuse>::visit([](const Scratch& s){
+        std::cout << "ResetOnReuse slot owner=" << s.owner << std::endl;
+    });
+
+    //每个核一份实例，线程可能被调度到别的核，所以计数必须是原子的
+    run_threads(kThreads, [](int){
+        for(int i = 0; i < kOps; i++){
+            PerCpuSingleton<Counter>::instance()->value.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    PerCpuSingleton<Counter>::instance(0)->value.fetch_add(1, std::memory_order_relaxed);
+    total = PerCpuSingleton<Counter>::aggregate(0L, [](long acc, const Counter& c){ return acc + sum(c); });
+    assert(total == (long)kThreads * kOps + 1);
+    std::cout << "PerCpuSingleton cpus=" << PerCpuSingleton<Counter>::cpu_count() << " total=" << total << std::endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <mutex>
+#include <vector>
+
+//每个线程一份实例的单例
+//适合计数器、缓冲区这类热路径上频繁修改的状态：每个线程只改自己的那份，不需要锁，
+//每份独占cache line，不同线程之间没有伪共享
+//需要整体结果时用visit/aggregate遍历所有线程的实例
+namespace single{
+
+//线程退出后槽位会给新线程复用，Reuse决定复用时怎么处理上一个线程留下的数据
+//on_reuse在注册表的锁里调用，不会和visit同时进行
+//保留数据：累加型的统计(比如metrics的计数器)退出线程的贡献不会丢
+struct KeepOnReuse{
+    template <typename T>
+    static void on_reuse(T&){}
+};
+
+//恢复成值初始化的状态：缓冲区、线程私有的上下文这类不应该被下一个线程看到的数据
+struct ResetOnReuse{
+    template <typename T>
+    static void on_reuse(T& value){
+        value = T{};
+    }
+};
+
+template <typename T, typename Reuse = KeepOnReuse>
+class ThreadLocalSingleton{
+public:
+    //快路径只读一次线程局部的普通指针
+    static T* instance(){
+        T* instance = local_;
+        if(instance == nullptr){
+            instance = attach();
+        }
+        return instance;
+    }
+
+    //遍历所有线程的实例(包括已退出线程留下的)
+    //遍历时拥有者线程可能还在修改，T的字段需要能并发读(比如relaxed的atomic)
+    template <typename F>
+    static void visit(F func){
+        Registry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for(Slot* slot : registry.slots){
+            func(slot->value);
+        }
+    }
+
+    //acc = func(acc, 每个实例)
+    template <typename R, typename F>
+    static R aggregate(R init, F func){
+        visit([&](const T& value){ init = func(init, value); });
+        return init;
+    }
+
+private:
+    ThreadLocalSingleton();
+
+    struct alignas(64) Slot{
+        T value{};
+        bool used = false;
+    };
+
+    struct Registry{
+        std::mutex mutex;
+        std::vector<Slot*> slots;
+    };
+
+    //线程退出时把槽位标记为空闲，下一个新线程接着用，数据是否保留由Reuse决定
+    //这样槽位数不超过同时存在的线程数
+    struct Releaser{
+        Slot* slot = nullptr;
+        ~Releaser(){
+            if(slot != nullptr){
+                Registry& registry = get_registry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                slot->used = false;
+            }
+            local_ = nullptr;
+        }
+    };
+
+    static Registry& get_registry(){
+        //故意不释放，其他线程退出时可能晚于静态对象析构
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    static T* attach(){
+        Registry& registry = get_registry();
+        Slot* found = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for(Slot* slot : registry.slots){
+                if(!slot->used){
+                    found = slot;
+                    Reuse::on_reuse(found->value);
+                    break;
+                }
+            }
+            if(found == nullptr){
+                found = new Slot();
+                registry.slots.push_back(found);
+            }
+            found->used = true;
+        }
+        releaser_.slot = found;
+        local_ = &found->value;
+        return local_;
+    }
+
+private:
+    //热路径只碰这个平凡类型的thread_local，不会触发线程局部对象的初始化检查
+    static thread_local T* local_;
+    static thread_local Releaser releaser_;
+};
+
+template <typename T, typename Reuse>
+thread_local T* ThreadLocalSingleton<T, Reuse>::local_ = nullptr;
+
+template <typename T, typename Reuse>
+thread_local typename ThreadLocalSingleton<T, Reuse>::Releaser ThreadLocalSingleton<T, Reuse>::releaser_;
+
+} // namespace single
@@ -0,0 +1,102 @@
+// g++ bench.cpp -std=c++17 -O2 -o bench
+#include "small_vector.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+using std::cout;
+using std::endl;
+
+// 统计堆分配次数
+static size_t g_alloc_count = 0;
+
+void* operator new(std::size_t size)
+{
+	g_alloc_count++;
+	if (void* p = std::malloc(size))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+template <typename F>
+double time_ns(size_t n, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+// 一百万个小集合，大小在[0, max_size]之间随机
+// create：逐个push_back建出来；scan：顺序遍历求和，看数据是否挨在一起
+template <typename Vec>
+void bench(const char* name, size_t max_size)
+{
+	const size_t n = 1000000;
+	std::mt19937 rng(7);
+	std::vector<size_t> sizes(n);
+	for (size_t& size : sizes)
+	{
+		size = rng() % (max_size + 1);
+	}
+
+	std::vector<Vec> all;
+	all.reserve(n);
+	size_t before = g_alloc_count;
+	double create = time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			all.emplace_back();
+			Vec& v = all.back();
+			for (size_t k = 0; k < sizes[i]; k++)
+			{
+				v.push_back((int)(i + k));
+			}
+		}
+	});
+	size_t allocs = g_alloc_count - before;
+
+	long sum = 0;
+	double scan = time_ns(n, [&] {
+		for (const Vec& v : all)
+		{
+			for (int x : v)
+			{
+				sum += x;
+			}
+		}
+	});
+
+	double destroy = time_ns(n, [&] { all.clear(); });
+
+	cout << name << " max_size=" << max_size << ": sizeof=" << sizeof(Vec)
+		<< " allocs/object=" << (double)allocs / n
+		<< " create=" << create << "ns"
+		<< " scan=" << scan << "ns"
+		<< " destroy=" << destroy << "ns"
+		<< " (" << sum << ")" << endl;
+}
+
+int main()
+{
+	for (size_t max_size : {4, 8, 32})
+	{
+		bench<std::vector<int>>("std::vector<int>", max_size);
+		bench<vec::SmallVector<int, 8>>("SmallVector<int, 8>", max_size);
+	}
+	return 0;
+}
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace vec{
+
+// 小对象优化的vector：前N个元素直接放在对象内部(和MArray<T, N>一样的内联数组)，超过N个才去堆上分配
+// 大部分情况下很小的集合(每个类的字段列表、参数列表)因此完全不用分配内存，元素和头部挨在同一组cache line里
+// 接口是std::vector常用的子集；和std::vector不同的是，内联状态下移动需要逐个移动元素，迭代器也会失效
+template <typename T, size_t N>
+class SmallVector
+{
+	static_assert(N > 0, "use std::vector when no inline storage is needed");
+
+public:
+	typedef T value_type;
+	typedef size_t size_type;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	SmallVector() : m_begin(inline_data()), m_size(0), m_capacity(N) {}
+
+	explicit SmallVector(size_t n) : SmallVector()
+	{
+		resize(n);
+	}
+
+	SmallVector(size_t n, const T& value) : SmallVector()
+	{
+		resize(n, value);
+	}
+
+	SmallVector(std::initializer_list<T> init) : SmallVector()
+	{
+		append(init.begin(), init.end());
+	}
+
+	template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+	SmallVector(It first, It last) : SmallVector()
+	{
+		append(first, last);
+	}
+
+	SmallVector(const SmallVector& other) : SmallVector()
+	{
+		append(other.begin(), other.end());
+	}
+
+	// 对方在堆上时直接接管内存，内联时逐个移动
+	SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) : SmallVector()
+	{
+		take(std::move(other));
+	}
+
+	~SmallVector()
+	{
+		destroy(m_begin, m_begin + m_size);
+		deallocate();
+	}
+
+	SmallVector& operator=(const SmallVector& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			append(other.begin(), other.end());
+		}
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+	{
+		if (this != &other)
+		{
+			clear();
+			deallocate();
+			m_begin = inline_data();
+			m_capacity = N;
+			take(std::move(other));
+		}
+		return *this;
+	}
+
+	SmallVector& operator=(std::initializer_list<T> init)
+	{
+		clear();
+		append(init.begin(), init.end());
+		return *this;
+	}
+
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_capacity; }
+	bool empty() const { return m_size == 0; }
+	// 元素是否还在内联存储里
+	bool is_inline() const { return m_begin == inline_data(); }
+
+	T* data() { return m_begin; }
+	const T* data() const { return m_begin; }
+	iterator begin() { return m_begin; }
+	iterator end() { return m_begin + m_size; }
+	const_iterator begin() const { return m_begin; }
+	const_iterator end() const { return m_begin + m_size; }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	T& operator[](size_t pos) { return m_begin[pos]; }
+	const T& operator[](size_t pos) const { return m_begin[pos]; }
+
+	T& at(size_t pos)
+	{
+		if (pos >= m_size)
+		{
+			throw std::out_of_range("SmallVector::at");
+		}
+		return m_begin[pos];
+	}
+
+	const T& at(size_t pos) const
+	{
+		return const_cast<SmallVector*>(this)->at(pos);
+	}
+
+	T& front() { return m_begin[0]; }
+	const T& front() const { return m_begin[0]; }
+	T& back() { return m_begin[m_size - 1]; }
+	const T& back() const { return m_begin[m_size - 1]; }
+
+	void push_back(const T& value) { emplace_back(value); }
+	void push_back(T&& value) { emplace_back(std::move(value)); }
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		if (m_size == m_capacity)
+		{
+			return grow_emplace(std::forward<Args>(args)...);
+		}
+		T* p = ::new (static_cast<void*>(m_begin + m_size)) T(std::forward<Args>(args)...);
+		m_size++;
+		return *p;
+	}
+
+	void pop_back()
+	{
+		m_size--;
+		m_begin[m_size].~T();
+	}
+
+	void clear()
+	{
+		destroy(m_begin, m_begin + m_size);
+		m_size = 0;
+	}
+
+	void reserve(size_t capacity)
+	{
+		if (capacity > m_capacity)
+		{
+			reallocate(capacity);
+		}
+	}
+
+	void resize(size_t n)
+	{
+		reserve(n);
+		for (; m_size < n; m_size++)
+		{
+			::new (static_cast<void*>(m_begin + m_size)) T();
+		}
+		shrink_to(n);
+	}
+
+	void resize(size_t n, const T& value)
+	{
+		if (n > m_capacity)
+		{
+			T copy(value);  // value可能就是本容器的元素
+			reallocate(n);
+			fill_to(n, copy);
+		}
+		else
+		{
+			fill_to(n, value);
+		}
+		shrink_to(n);
+	}
+
+	iterator insert(const_iterator pos, const T& value)
+	{
+		return emplace(pos, value);
+	}
+
+	iterator insert(const_iterator pos, T&& value)
+	{
+		return emplace(pos, std::move(value));
+	}
+
+	// 先放到末尾再旋转到位置上，元素引用自身时也不会出错
+	template <typename... Args>
+	iterator emplace(const_iterator pos, Args&&... args)
+	{
+		size_t index = pos - m_begin;
+		emplace_back(std::forward<Args>(args)...);
+		std::rotate(m_begin + index, m_begin + m_size - 1, m_begin + m_size);
+		return m_begin + index;
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		return erase(pos, pos + 1);
+	}
+
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		T* dst = const_cast<T*>(first);
+		T* src = const_cast<T*>(last);
+		T* new_end = std::move(src, end(), dst);
+		shrink_to(new_end - m_begin);
+		return dst;
+	}
+
+	template <typename It>
+	void append(It first, It last)
+	{
+		if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value)
+		{
+			reserve(m_size + std::distance(first, last));
+		}
+		for (; first != last; ++first)
+		{
+			emplace_back(*first);
+		}
+	}
+
+	void swap(SmallVector& other)
+	{
+		SmallVector tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+private:
+	T* inline_data() { return reinterpret_cast<T*>(m_inline); }
+	const T* inline_data() const { return reinterpret_cast<const T*>(m_inline); }
+
+	static void destroy(T* first, T* last)
+	{
+		for (; first != last; ++first)
+		{
+			first->~T();
+		}
+	}
+
+	void deallocate()
+	{
+		if (!is_inline())
+		{
+			std::allocator<T>().deallocate(m_begin, m_capacity);
+		}
+	}
+
+	void shrink_to(size_t n)
+	{
+		if (n < m_size)
+		{
+			destroy(m_begin + n, m_begin + m_size);
+			m_size = n;
+		}
+	}
+
+	void fill_to(size_t n, const T& value)
+	{
+		for (; m_size < n; m_size++)
+		{
+			::new (static_cast<void*>(m_begin + m_size)) T(value);
+		}
+	}
+
+	void reallocate(size_t capacity)
+	{
+		T* storage = std::allocator<T>().allocate(capacity);
+		try
+		{
+			relocate(storage);
+		}
+		catch (...)
+		{
+			std::allocator<T>().deallocate(storage, capacity);
+			throw;
+		}
+		destroy(m_begin, m_begin + m_size);
+		deallocate();
+		m_begin = storage;
+		m_capacity = capacity;
+	}
+
+	// 把元素搬到新的内存上：移动不会抛异常(或者只能移动)时移动，否则拷贝，失败时旧元素不受影响
+	void relocate(T* storage)
+	{
+		if constexpr (std::is_nothrow_move_constructible<T>::value || !std::is_copy_constructible<T>::value)
+		{
+			std::uninitialized_copy(std::make_move_iterator(m_begin), std::make_move_iterator(m_begin + m_size), storage);
+		}
+		else
+		{
+			std::uninitialized_copy(m_begin, m_begin + m_size, storage);
+		}
+	}
+
+	// 空间不够时：先在新内存上构造新元素(参数可能引用旧元素)，再搬旧元素
+	template <typename... Args>
+	T& grow_emplace(Args&&... args)
+	{
+		size_t capacity = m_capacity * 2;
+		T* storage = std::allocator<T>().allocate(capacity);
+		T* p = nullptr;
+		try
+		{
+			p = ::new (static_cast<void*>(storage + m_size)) T(std::forward<Args>(args)...);
+			relocate(storage);
+		}
+		catch (...)
+		{
+			if (p != nullptr)
+			{
+				p->~T();
+			}
+			std::allocator<T>().deallocate(storage, capacity);
+			throw;
+		}
+		destroy(m_begin, m_begin + m_size);
+		deallocate();
+		m_begin = storage;
+		m_capacity = capacity;
+		m_size++;
+		return *p;
+	}
+
+	void take(SmallVector&& other)
+	{
+		if (other.is_inline())
+		{
+			for (size_t i = 0; i < other.m_size; i++)
+			{
+				::new (static_cast<void*>(m_begin + i)) T(std::move(other.m_begin[i]));
+				m_size = i + 1;
+			}
+			other.clear();
+		}
+		else
+		{
+			m_begin = other.m_begin;
+			m_size = other.m_size;
+			m_capacity = other.m_capacity;
+			other.m_begin = other.inline_data();
+			other.m_size = 0;
+			other.m_capacity = N;
+		}
+	}
+
+private:
+	T* m_begin;           //指向内联存储或堆内存
+	size_t m_size;
+	size_t m_capacity;
+	alignas(T) unsigned char m_inline[sizeof(T) * N];
+};
+
+template <typename T, size_t N>
+bool operator==(const SmallVector<T, N>& a, const SmallVector<T, N>& b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T, size_t N>
+bool operator!=(const SmallVector<T, N>& a, const SmallVector<T, N>& b)
+{
+	return !(a == b);
+}
+
+} // namespace vec
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include "shared_ptr.h"
+
+namespace smart_ptr{
+
+namespace detail{
+// 基于epoch的延迟回收
+// 全局有一个递增的epoch，每个线程一个独占cache line的槽位，记录自己进入读临界区时看到的epoch(0表示不在读)
+// 写者替换指针后把epoch加1，旧对象记上替换时的epoch，
+// 等所有正在读的线程的槽位都大于这个epoch(或者不在读)，就说明没人还拿着旧指针，可以释放
+class epoch_domain
+{
+public:
+	static const int kMaxThreads = 256;
+
+	static epoch_domain& instance()
+	{
+		static epoch_domain domain;
+		return domain;
+	}
+
+	// 读者进入/退出，支持嵌套，只有最外层才写槽位
+	void enter()
+	{
+		thread_slot& ts = local();
+		if (ts.depth++ == 0)
+		{
+			// 先公布epoch再读指针，两步都是seq_cst，写者扫描槽位时才不会漏掉
+			ts.entry->epoch.store(m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+		}
+	}
+
+	void leave()
+	{
+		thread_slot& ts = local();
+		if (--ts.depth == 0)
+		{
+			ts.entry->epoch.store(0, std::memory_order_release);
+		}
+	}
+
+	// 写者替换指针之后调用，返回替换发生的epoch
+	uint64_t advance()
+	{
+		return m_epoch.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	// 所有正在读的线程里最小的epoch，没人在读时返回当前epoch+1
+	uint64_t min_active() const
+	{
+		uint64_t min = m_epoch.load(std::memory_order_seq_cst) + 1;
+		for (int i = 0; i < kMaxThreads; i++)
+		{
+			uint64_t e = m_slots[i].epoch.load(std::memory_order_seq_cst);
+			if (e != 0 && e < min)
+			{
+				min = e;
+			}
+		}
+		return min;
+	}
+
+private:
+	struct alignas(64) slot
+	{
+		std::atomic<uint64_t> epoch{0};
+		std::atomic<bool> used{false};
+	};
+
+	// 线程第一次读时占一个槽位，线程退出时还回去
+	struct thread_slot
+	{
+		slot* entry = nullptr;
+		int depth = 0;
+
+		~thread_slot()
+		{
+			if (entry != nullptr)
+			{
+				entry->epoch.store(0, std::memory_order_release);
+				entry->used.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	epoch_domain() : m_epoch(1) {}
+
+	thread_slot& local()
+	{
+		static thread_local thread_slot ts;
+		if (ts.entry == nullptr)
+		{
+			ts.entry = acquire_slot();
+		}
+		return ts;
+	}
+
+	slot* acquire_slot()
+	{
+		for (int i = 0; i < kMaxThreads; i++)
+		{
+			bool expected = false;
+			if (!m_slots[i].used.load(std::memory_order_relaxed)
+				&& m_slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+			{
+				return &m_slots[i];
+			}
+		}
+		throw std::logic_error("epoch_domain: too many reader threads");
+	}
+
+	alignas(64) std::atomic<uint64_t> m_epoch;
+	slot m_slots[kMaxThreads];
+};
+} // namespace detail
+
+// 读多写少的共享快照(比如运行时替换的配置)
+// 读者用read()拿一个guard，期间对象不会被释放，全程不碰shared_ptr的引用计数，
+// 只写自己线程的槽位，多核读者之间没有共享的cache line
+// 写者用store()发布新快照，旧快照在所有读者离开之后释放
+// 需要把快照带出读临界区时用load()，拿到的是普通的shared_ptr
+template <typename T>
+class atomic_shared_ptr
+{
+	struct node
+	{
+		shared_ptr<T> ptr;
+		uint64_t retired;
+	};
+
+public:
+	// 读临界区，析构时退出，不能跨线程传递
+	class read_guard
+	{
+	public:
+		explicit read_guard(const atomic_shared_ptr& owner)
+		{
+			detail::epoch_domain::instance().enter();
+			m_node = owner.m_node.load(std::memory_order_seq_cst);
+		}
+
+		~read_guard()
+		{
+			detail::epoch_domain::instance().leave();
+		}
+
+		read_guard(const read_guard&) = delete;
+		read_guard& operator=(const read_guard&) = delete;
+
+		const T* get() const { return m_node->ptr.get(); }
+		const T& operator*() const { return *get(); }
+		const T* operator->() const { return get(); }
+		explicit operator bool() const { return get() != nullptr; }
+
+		// 拷贝出一个shared_ptr，可以在guard析构之后继续使用
+		shared_ptr<T> share() const { return m_node->ptr; }
+
+	private:
+		node* m_node;
+	};
+
+	atomic_shared_ptr() : m_node(new node{shared_ptr<T>(), 0}) {}
+	explicit atomic_shared_ptr(shared_ptr<T> ptr) : m_node(new node{std::move(ptr), 0}) {}
+
+	// 析构时不能再有读者
+	~atomic_shared_ptr()
+	{
+		delete m_node.load(std::memory_order_relaxed);
+		for (node* old : m_retired)
+		{
+			delete old;
+		}
+	}
+
+	atomic_shared_ptr(const atomic_shared_ptr&) = delete;
+	atomic_shared_ptr& operator=(const atomic_shared_ptr&) = delete;
+
+	read_guard read() const
+	{
+		return read_guard(*this);
+	}
+
+	shared_ptr<T> load() const
+	{
+		return read().share();
+	}
+
+	// 发布新快照，顺便回收已经没人读的旧快照
+	void store(shared_ptr<T> ptr)
+	{
+		node* fresh = new node{std::move(ptr), 0};
+		node* old = m_node.exchange(fresh, std::memory_order_seq_cst);
+		old->retired = detail::epoch_domain::instance().advance();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_retired.push_back(old);
+		collect_locked();
+	}
+
+	// 回收旧快照，返回还没能回收的个数
+	size_t collect()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		collect_locked();
+		return m_retired.size();
+	}
+
+private:
+	void collect_locked()
+	{
+		uint64_t min = detail::epoch_domain::instance().min_active();
+		size_t kept = 0;
+		for (node* old : m_retired)
+		{
+			if (old->retired < min)
+			{
+				delete old;
+			}
+			else
+			{
+				m_retired[kept++] = old;
+			}
+		}
+		m_retired.resize(kept);
+	}
+
+private:
+	std::atomic<node*> m_node;
+	std::mutex m_mutex;            //只保护写者的回收列表，读者不碰
+	std::vector<node*> m_retired;
+};
+
+} // namespace smart_ptr
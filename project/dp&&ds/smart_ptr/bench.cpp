@@ -0,0 +1,206 @@
+// g++ bench.cpp -std=c++17 -O2 -o bench
+#include "shared_ptr.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+using std::cout;
+using std::endl;
+
+// 统计堆分配次数
+static size_t g_alloc_count = 0;
+
+void* operator new(std::size_t size)
+{
+	g_alloc_count++;
+	if (void* p = std::malloc(size))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+// 统计引用计数的增减次数，只在count_grow_ops里使用
+static size_t g_ref_ops = 0;
+
+struct counting_count : smart_ptr::atomic_count
+{
+	static void inc(type& c) { g_ref_ops++; atomic_count::inc(c); }
+	static long dec(type& c) { g_ref_ops++; return atomic_count::dec(c); }
+	static bool inc_if_nonzero(type& c) { g_ref_ops++; return atomic_count::inc_if_nonzero(c); }
+};
+
+struct Node
+{
+	Node(int a, int b) : a(a), b(b) {}
+	int a;
+	int b;
+};
+
+template <typename F>
+double time_ns(size_t n, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+template <typename Ptr, typename Make>
+void bench(const char* name, Make make)
+{
+	const size_t n = 1000000;
+
+	size_t before = g_alloc_count;
+	std::vector<Ptr> ptrs;
+	ptrs.reserve(n);
+	double create = time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			ptrs.push_back(make(i));
+		}
+	});
+	size_t allocs = g_alloc_count - before;
+
+	// 拷贝构造 + 析构
+	long sum = 0;
+	double copy = time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			Ptr copy = ptrs[i];
+			sum += copy->a;
+		}
+	});
+
+	// 拷贝赋值
+	Ptr holder = ptrs[0];
+	double assign = time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			holder = ptrs[i];
+		}
+	});
+
+	// 不预留空间的vector：元素移动进来，扩容时也靠移动搬家
+	std::vector<Ptr> grown;
+	double grow = time_ns(n, [&] {
+		for (size_t i = 0; i < n; i++)
+		{
+			grown.push_back(std::move(ptrs[i]));
+		}
+	});
+	ptrs.swap(grown);
+
+	cout << name << ": sizeof=" << sizeof(Ptr)
+		<< " allocs/object=" << (double)allocs / n
+		<< " create=" << create << "ns"
+		<< " copy=" << copy << "ns"
+		<< " assign=" << assign << "ns"
+		<< " grow=" << grow << "ns"
+		<< " (" << sum << ")" << endl;
+}
+
+// vector扩容时统计引用计数的增减次数：移动构造是noexcept，搬家不碰计数，应该是0
+void count_grow_ops()
+{
+	typedef smart_ptr::shared_ptr<Node, counting_count> Ptr;
+	const size_t n = 1000000;
+	std::vector<Ptr> ptrs;
+	ptrs.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		ptrs.push_back(Ptr(new Node((int)i, 0)));
+	}
+
+	std::vector<Ptr> grown;
+	size_t reallocs = 0;
+	size_t ops = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (grown.size() == grown.capacity())
+		{
+			size_t before = g_ref_ops;
+			grown.reserve(grown.capacity() == 0 ? 1 : grown.capacity() * 2);
+			ops += g_ref_ops - before;
+			reallocs++;
+		}
+		grown.push_back(ptrs[i]);
+	}
+	cout << "vector growth: reallocations=" << reallocs
+		<< " ref count ops during reallocation=" << ops
+		<< " (push_back copies=" << g_ref_ops << ")" << endl;
+}
+
+// 多个线程同时拷贝/析构同一个对象的shared_ptr，所有线程争用同一个计数
+template <typename Ptr>
+void bench_threads(const char* name, const Ptr& shared, unsigned threads)
+{
+	const size_t n = 1000000;
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&] {
+			for (size_t i = 0; i < n; i++)
+			{
+				Ptr copy = shared;
+				Ptr other = copy;
+			}
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+
+	cout << name << " threads=" << threads
+		<< " copy+destroy x2=" << ns << "ns"
+		<< " use_count after=" << shared.use_count() << endl;
+}
+
+int main()
+{
+	bench<smart_ptr::shared_ptr<Node>>("smart_ptr::make_shared", [](size_t i) {
+		return smart_ptr::make_shared<Node>((int)i, 0);
+	});
+	bench<smart_ptr::shared_ptr<Node>>("smart_ptr::shared_ptr(new)", [](size_t i) {
+		return smart_ptr::shared_ptr<Node>(new Node((int)i, 0));
+	});
+	bench<smart_ptr::local_shared_ptr<Node>>("smart_ptr::make_local_shared", [](size_t i) {
+		return smart_ptr::make_local_shared<Node>((int)i, 0);
+	});
+	bench<std::shared_ptr<Node>>("std::make_shared", [](size_t i) {
+		return std::make_shared<Node>((int)i, 0);
+	});
+	bench<std::shared_ptr<Node>>("std::shared_ptr(new)", [](size_t i) {
+		return std::shared_ptr<Node>(new Node((int)i, 0));
+	});
+
+	count_grow_ops();
+
+	auto sp = smart_ptr::make_shared<Node>(1, 2);
+	auto std_sp = std::make_shared<Node>(1, 2);
+	for (unsigned threads = 1; threads <= std::thread::hardware_concurrency() && threads <= 8; threads *= 2)
+	{
+		bench_threads("smart_ptr::shared_ptr", sp, threads);
+		bench_threads("std::shared_ptr", std_sp, threads);
+	}
+	auto local = smart_ptr::make_local_shared<Node>(1, 2);
+	bench_threads("smart_ptr::local_shared_ptr", local, 1);
+	return 0;
+}
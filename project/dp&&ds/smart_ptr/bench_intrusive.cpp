@@ -0,0 +1,117 @@
+// g++ bench_intrusive.cpp -std=c++17 -O2 -o bench_intrusive
+#include "intrusive_ptr.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+using std::cout;
+using std::endl;
+
+// 一张随机图：每个节点有kEdges条出边，指向随机节点
+// 遍历时沿着边随机游走，每一步都拷贝一次指针(和真实代码里把邻居存到局部变量一样)
+const int kEdges = 4;
+
+template <typename Ptr>
+struct NodeBase
+{
+	int value = 0;
+	Ptr edges[kEdges];
+};
+
+struct SNode : NodeBase<smart_ptr::shared_ptr<SNode>> {};
+struct LNode : NodeBase<smart_ptr::local_shared_ptr<LNode>> {};
+struct INode : NodeBase<smart_ptr::intrusive_ptr<INode>>, smart_ptr::intrusive_ref_counter<INode> {};
+struct ILNode : NodeBase<smart_ptr::intrusive_ptr<ILNode>>, smart_ptr::local_ref_counter<ILNode> {};
+
+template <typename F>
+double time_ns(size_t n, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+template <typename Ptr, typename Make>
+void bench(const char* name, size_t nodes, Make make)
+{
+	std::mt19937 rng(42);
+	std::vector<Ptr> all;
+	all.reserve(nodes);
+	for (size_t i = 0; i < nodes; i++)
+	{
+		all.push_back(make());
+		all.back()->value = (int)rng();
+	}
+	// 打乱之后再连边，邻居在内存里是随机分布的
+	for (size_t i = 0; i < nodes; i++)
+	{
+		for (int e = 0; e < kEdges; e++)
+		{
+			all[i]->edges[e] = all[rng() % nodes];
+		}
+	}
+
+	const size_t steps = 4000000;
+	long sum = 0;
+	double walk = time_ns(steps, [&] {
+		Ptr cur = all[0];
+		for (size_t i = 0; i < steps; i++)
+		{
+			cur = cur->edges[(unsigned)cur->value % kEdges];
+			sum += cur->value;
+		}
+	});
+
+	// 把所有边拷贝一遍：只看计数操作本身的开销
+	std::vector<Ptr> copies;
+	copies.reserve(nodes * kEdges);
+	double copy = time_ns(nodes * kEdges, [&] {
+		for (size_t i = 0; i < nodes; i++)
+		{
+			for (int e = 0; e < kEdges; e++)
+			{
+				copies.push_back(all[i]->edges[e]);
+			}
+		}
+	});
+	double drop = time_ns(nodes * kEdges, [&] { copies.clear(); });
+
+	cout << name << " nodes=" << nodes << ": sizeof(Ptr)=" << sizeof(Ptr)
+		<< " walk=" << walk << "ns/step"
+		<< " copy=" << copy << "ns"
+		<< " destroy=" << drop << "ns"
+		<< " (" << sum << ")" << endl;
+
+	// 图里有环，先拆边再释放节点
+	for (auto& node : all)
+	{
+		for (int e = 0; e < kEdges; e++)
+		{
+			node->edges[e].reset();
+		}
+	}
+}
+
+int main()
+{
+	for (size_t nodes : {1000, 100000, 2000000})
+	{
+		bench<smart_ptr::shared_ptr<SNode>>("shared_ptr(new)", nodes, [] {
+			return smart_ptr::shared_ptr<SNode>(new SNode());
+		});
+		bench<smart_ptr::shared_ptr<SNode>>("make_shared", nodes, [] {
+			return smart_ptr::make_shared<SNode>();
+		});
+		bench<smart_ptr::local_shared_ptr<LNode>>("make_local_shared", nodes, [] {
+			return smart_ptr::make_local_shared<LNode>();
+		});
+		bench<smart_ptr::intrusive_ptr<INode>>("intrusive_ptr", nodes, [] {
+			return smart_ptr::make_intrusive<INode>();
+		});
+		bench<smart_ptr::intrusive_ptr<ILNode>>("intrusive_ptr(local)", nodes, [] {
+			return smart_ptr::make_intrusive<ILNode>();
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+// g++ bench_snapshot.cpp -std=c++17 -O2 -pthread -o bench_snapshot
+#include "atomic_shared_ptr.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::cout;
+using std::endl;
+
+// 多个读者不停读配置快照，一个写者每隔1ms替换一次
+// 对比三种做法：
+//   mutex + smart_ptr::shared_ptr拷贝：锁和计数都在所有读者间共享
+//   std::atomic_load(std::shared_ptr)：libstdc++里是一组全局自旋锁 + 原子计数
+//   atomic_shared_ptr::read()：只写本线程的epoch槽位
+struct Config
+{
+	long values[8];
+	explicit Config(long v)
+	{
+		for (long& x : values)
+		{
+			x = v;
+		}
+	}
+};
+
+template <typename Read, typename Write>
+void bench(const char* name, unsigned readers, Read read, Write write)
+{
+	const size_t n = 2000000;
+	std::atomic<bool> stop{false};
+	std::thread writer([&] {
+		long v = 0;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			write(++v);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	std::vector<std::thread> workers;
+	std::atomic<long> total{0};
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < readers; t++)
+	{
+		workers.emplace_back([&] {
+			long sum = 0;
+			for (size_t i = 0; i < n; i++)
+			{
+				sum += read();
+			}
+			total += sum;
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	auto end = std::chrono::steady_clock::now();
+	stop = true;
+	writer.join();
+
+	double sec = std::chrono::duration<double>(end - start).count();
+	cout << name << " readers=" << readers
+		<< " reads/s=" << n * readers / sec / 1e6 << "M"
+		<< " ns/read/thread=" << sec * 1e9 / n
+		<< " (" << total.load() << ")" << endl;
+}
+
+int main()
+{
+	unsigned cores = std::thread::hardware_concurrency();
+	for (unsigned readers = 1; readers <= cores; readers *= 2)
+	{
+		std::mutex mutex;
+		smart_ptr::shared_ptr<Config> locked = smart_ptr::make_shared<Config>(0);
+		bench("mutex + shared_ptr", readers,
+			[&] {
+				smart_ptr::shared_ptr<Config> copy;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					copy = locked;
+				}
+				return copy->values[3];
+			},
+			[&](long v) {
+				smart_ptr::shared_ptr<Config> fresh = smart_ptr::make_shared<Config>(v);
+				std::lock_guard<std::mutex> lock(mutex);
+				locked.swap(fresh);
+			});
+
+		std::shared_ptr<Config> std_sp = std::make_shared<Config>(0);
+		bench("std::atomic_load", readers,
+			[&] { return std::atomic_load(&std_sp)->values[3]; },
+			[&](long v) { std::atomic_store(&std_sp, std::make_shared<Config>(v)); });
+
+		smart_ptr::atomic_shared_ptr<Config> snapshot(smart_ptr::make_shared<Config>(0));
+		bench("atomic_shared_ptr::read", readers,
+			[&] { return snapshot.read()->values[3]; },
+			[&](long v) { snapshot.store(smart_ptr::make_shared<Config>(v)); });
+	}
+	return 0;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <utility>
+#include <type_traits>
+#include "shared_ptr.h"
+
+namespace smart_ptr{
+
+// 侵入式引用计数：计数放在对象自己身上
+// 解引用和拷贝只碰对象本身的cache line，也不用额外分配控制块
+// T需要提供两个能通过ADL找到的函数：
+//   void intrusive_ptr_add_ref(T*);
+//   void intrusive_ptr_release(T*);   计数到0时负责释放对象
+// 继承intrusive_ref_counter就会自动有这两个函数
+
+// 计数策略复用shared_ptr的atomic_count/local_count
+template <typename Derived, typename Policy = atomic_count>
+class intrusive_ref_counter
+{
+public:
+	long use_count() const
+	{
+		return Policy::load(m_refs);
+	}
+
+	friend void intrusive_ptr_add_ref(const intrusive_ref_counter* p)
+	{
+		Policy::inc(p->m_refs);
+	}
+
+	friend void intrusive_ptr_release(const intrusive_ref_counter* p)
+	{
+		if (Policy::dec(p->m_refs) == 0)
+		{
+			delete static_cast<const Derived*>(p);
+		}
+	}
+
+protected:
+	intrusive_ref_counter() {}
+	// 拷贝出来的是一个新对象，计数从0开始
+	intrusive_ref_counter(const intrusive_ref_counter&) {}
+	intrusive_ref_counter& operator=(const intrusive_ref_counter&) { return *this; }
+	~intrusive_ref_counter() {}
+
+private:
+	mutable typename Policy::type m_refs{0};
+};
+
+// 单线程版本
+template <typename Derived>
+using local_ref_counter = intrusive_ref_counter<Derived, local_count>;
+
+template <typename T>
+class intrusive_ptr
+{
+	template <typename U>
+	friend class intrusive_ptr;
+
+	template <typename U>
+	using convertible = typename std::enable_if<std::is_convertible<U*, T*>::value>::type;
+
+public:
+	intrusive_ptr() noexcept : m_pobject(nullptr) {}
+
+	// add_ref为false时接管一个已经计过数的指针(比如detach出来的)
+	intrusive_ptr(T* p, bool add_ref = true) : m_pobject(p)
+	{
+		if (m_pobject != nullptr && add_ref)
+		{
+			intrusive_ptr_add_ref(m_pobject);
+		}
+	}
+
+	intrusive_ptr(const intrusive_ptr& rhs) : m_pobject(rhs.m_pobject)
+	{
+		if (m_pobject != nullptr)
+		{
+			intrusive_ptr_add_ref(m_pobject);
+		}
+	}
+
+	intrusive_ptr(intrusive_ptr&& rhs) noexcept : m_pobject(rhs.m_pobject)
+	{
+		rhs.m_pobject = nullptr;
+	}
+
+	template <typename U, typename = convertible<U>>
+	intrusive_ptr(const intrusive_ptr<U>& rhs) : m_pobject(rhs.m_pobject)
+	{
+		if (m_pobject != nullptr)
+		{
+			intrusive_ptr_add_ref(m_pobject);
+		}
+	}
+
+	template <typename U, typename = convertible<U>>
+	intrusive_ptr(intrusive_ptr<U>&& rhs) noexcept : m_pobject(rhs.m_pobject)
+	{
+		rhs.m_pobject = nullptr;
+	}
+
+	~intrusive_ptr()
+	{
+		if (m_pobject != nullptr)
+		{
+			intrusive_ptr_release(m_pobject);
+		}
+	}
+
+	intrusive_ptr& operator=(const intrusive_ptr& rhs)
+	{
+		intrusive_ptr(rhs).swap(*this);
+		return *this;
+	}
+
+	intrusive_ptr& operator=(intrusive_ptr&& rhs) noexcept
+	{
+		intrusive_ptr(std::move(rhs)).swap(*this);
+		return *this;
+	}
+
+	intrusive_ptr& operator=(T* p)
+	{
+		intrusive_ptr(p).swap(*this);
+		return *this;
+	}
+
+	T& operator*() const { return *m_pobject; }
+	T* operator->() const { return m_pobject; }
+	explicit operator bool() const { return m_pobject != nullptr; }
+	T* get() const { return m_pobject; }
+
+	void reset() { intrusive_ptr().swap(*this); }
+	void reset(T* p, bool add_ref = true) { intrusive_ptr(p, add_ref).swap(*this); }
+
+	// 交出指针但不减计数，之后由调用者负责release
+	T* detach() noexcept
+	{
+		T* p = m_pobject;
+		m_pobject = nullptr;
+		return p;
+	}
+
+	void swap(intrusive_ptr& rhs) noexcept
+	{
+		std::swap(m_pobject, rhs.m_pobject);
+	}
+
+private:
+	T* m_pobject;
+};
+
+template <typename T, typename U>
+bool operator==(const intrusive_ptr<T>& a, const intrusive_ptr<U>& b) { return a.get() == b.get(); }
+template <typename T, typename U>
+bool operator!=(const intrusive_ptr<T>& a, const intrusive_ptr<U>& b) { return a.get() != b.get(); }
+template <typename T, typename U>
+bool operator<(const intrusive_ptr<T>& a, const intrusive_ptr<U>& b) { return a.get() < b.get(); }
+
+template <typename T, typename... Args>
+intrusive_ptr<T> make_intrusive(Args&&... args)
+{
+	return intrusive_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+namespace detail{
+// shared_ptr的deleter：只是还掉shared_ptr占用的那一个侵入式计数
+struct intrusive_deleter
+{
+	template <typename T>
+	void operator()(T* p) const
+	{
+		intrusive_ptr_release(p);
+	}
+};
+} // namespace detail
+
+// 和shared_ptr互转
+// to_shared：shared_ptr整体只占对象的一个侵入式计数，最后一个shared_ptr析构时还回去
+// from_shared：对象上再加一个侵入式计数，之后两边互不影响
+//   只能用在to_shared得到的shared_ptr上(按控制块里deleter的类型检查)，
+//   make_shared或shared_ptr(new T)的对象由控制块释放，不能再交给侵入式计数，会抛std::logic_error
+template <typename Policy = atomic_count, typename T>
+shared_ptr<T, Policy> to_shared(intrusive_ptr<T> p)
+{
+	if (!p)
+	{
+		return shared_ptr<T, Policy>();
+	}
+	shared_ptr<T, Policy> sp(p.get(), detail::intrusive_deleter());
+	p.detach();
+	return sp;
+}
+
+template <typename T, typename Policy>
+intrusive_ptr<T> from_shared(const shared_ptr<T, Policy>& sp)
+{
+	if (!sp)
+	{
+		return intrusive_ptr<T>();
+	}
+	if (get_deleter<detail::intrusive_deleter>(sp) == nullptr)
+	{
+		throw std::logic_error("from_shared() on a shared_ptr not created by to_shared()");
+	}
+	return intrusive_ptr<T>(sp.get());
+}
+
+} // namespace smart_ptr
@@ -1,19 +1,224 @@
 #pragma once
 
-#include <functional>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
 
 namespace smart_ptr{
-// 模仿shared_ptr实现一个智能指针
+
+// 计数策略
+// 多线程：原子计数，增加用relaxed(只要不丢就行)，
+// 减少用acq_rel，保证最后一个释放者能看到其他线程对对象的所有修改
+struct atomic_count
+{
+	typedef std::atomic<long> type;
+
+	static void inc(type& c) { c.fetch_add(1, std::memory_order_relaxed); }
+	static long dec(type& c) { return c.fetch_sub(1, std::memory_order_acq_rel) - 1; }
+	static long load(const type& c) { return c.load(std::memory_order_relaxed); }
+	// weak_ptr::lock用：计数不为0时才加1
+	static bool inc_if_nonzero(type& c)
+	{
+		long n = c.load(std::memory_order_relaxed);
+		while (n != 0)
+		{
+			if (c.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+// 单线程：普通整数计数，只能在一个线程里使用
+struct local_count
+{
+	typedef long type;
+
+	static void inc(type& c) { ++c; }
+	static long dec(type& c) { return --c; }
+	static long load(const type& c) { return c; }
+	static bool inc_if_nonzero(type& c)
+	{
+		if (c == 0)
+		{
+			return false;
+		}
+		++c;
+		return true;
+	}
+};
+
+namespace detail{
+// 控制块：引用计数和释放对象的逻辑放在一起
+// deleter的类型只在控制块里出现，shared_ptr本身只有两个指针
+// weak_count = weak引用数 + (use_count > 0 ? 1 : 0)，
+// use_count到0时释放对象，weak_count到0时释放控制块
+template <typename Policy>
+struct ctrl_block
+{
+	typename Policy::type use_count{1};
+	typename Policy::type weak_count{1};
+
+	void add_ref() { Policy::inc(use_count); }
+	bool add_ref_lock() { return Policy::inc_if_nonzero(use_count); }
+
+	void release()
+	{
+		if (Policy::dec(use_count) == 0)
+		{
+			dispose();
+			weak_release();
+		}
+	}
+
+	void weak_add_ref() { Policy::inc(weak_count); }
+
+	void weak_release()
+	{
+		if (Policy::dec(weak_count) == 0)
+		{
+			destroy();
+		}
+	}
+
+	// 释放管理的对象
+	virtual void dispose() = 0;
+	// 释放控制块自己
+	virtual void destroy() = 0;
+	// 对象是否和控制块在同一块内存里(make_shared)
+	virtual bool inplace() const { return false; }
+	// deleter的类型是ti时返回它的地址，否则返回nullptr
+	virtual void* get_deleter(const std::type_info&) { return nullptr; }
+
+protected:
+	virtual ~ctrl_block() {}
+};
+
+// 管理外部new出来的指针，deleter按值存在控制块里，只拷贝一次
+template <typename T, typename D, typename Policy>
+struct ctrl_block_ptr : ctrl_block<Policy>
+{
+	ctrl_block_ptr(T* p, D d) : ptr(p), del(std::move(d)) {}
+
+	void dispose() override { del(ptr); }
+	void destroy() override { delete this; }
+	void* get_deleter(const std::type_info& ti) override { return ti == typeid(D) ? &del : nullptr; }
+
+	T* ptr;
+	D del;
+};
+
+// make_shared用：对象直接构造在控制块里，一次分配
+template <typename T, typename Policy>
+struct ctrl_block_inplace : ctrl_block<Policy>
+{
+	template <typename... Args>
+	explicit ctrl_block_inplace(Args&&... args)
+	{
+		::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+	}
+
+	T* get() { return reinterpret_cast<T*>(storage); }
+
+	void dispose() override { get()->~T(); }
+	void destroy() override { delete this; }
+	bool inplace() const override { return true; }
+
+	alignas(T) unsigned char storage[sizeof(T)];
+};
+
+// allocate_shared用：和ctrl_block_inplace一样一次分配，但内存来自用户的allocator
+// allocator按rebind到控制块类型后的版本存在控制块里，释放控制块时再用它归还内存
+template <typename T, typename A, typename Policy>
+struct ctrl_block_inplace_alloc : ctrl_block<Policy>
+{
+	typedef typename std::allocator_traits<A>::template rebind_alloc<ctrl_block_inplace_alloc> alloc_type;
+	typedef std::allocator_traits<alloc_type> alloc_traits;
+
+	template <typename... Args>
+	explicit ctrl_block_inplace_alloc(const A& a, Args&&... args) : alloc(a)
+	{
+		::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+	}
+
+	T* get() { return reinterpret_cast<T*>(storage); }
+
+	void dispose() override { get()->~T(); }
+	void destroy() override
+	{
+		alloc_type a(std::move(alloc));
+		this->~ctrl_block_inplace_alloc();
+		alloc_traits::deallocate(a, this, 1);
+	}
+	bool inplace() const override { return true; }
+
+	alloc_type alloc;
+	alignas(T) unsigned char storage[sizeof(T)];
+};
+
+// 区分内部用控制块直接构造的构造函数
+struct ctrl_tag {};
+
 template <typename T>
+struct default_delete
+{
+	void operator()(T* p) const { delete p; }
+};
+} // namespace detail
+
+template <typename T, typename Policy>
+class weak_ptr;
+template <typename T, typename Policy>
+class enable_shared_from_this;
+
+// 模仿shared_ptr实现一个智能指针
+// Policy决定引用计数是否原子，默认是线程安全的atomic_count
+template <typename T, typename Policy = atomic_count>
 class shared_ptr
 {
+	typedef detail::ctrl_block<Policy> ctrl_type;
+
+	template <typename U, typename P>
+	friend class shared_ptr;
+	template <typename U, typename P>
+	friend class weak_ptr;
+	template <typename D, typename U, typename P>
+	friend D* get_deleter(const shared_ptr<U, P>&) noexcept;
+
+	template <typename U>
+	using convertible = typename std::enable_if<std::is_convertible<U*, T*>::value>::type;
+
 public:
 	shared_ptr();
 	//这里不允许直接从内部变量赋值
 	explicit shared_ptr(T*);
 	shared_ptr(const shared_ptr&);
-	shared_ptr(T*, std::function<void(T*)>);
+	//移动只是转移两个指针，不碰引用计数
+	shared_ptr(shared_ptr&&) noexcept;
+	//派生类指针转成基类指针
+	template <typename U, typename = convertible<U>>
+	shared_ptr(const shared_ptr<U, Policy>&);
+	template <typename U, typename = convertible<U>>
+	shared_ptr(shared_ptr<U, Policy>&&) noexcept;
+	//别名构造：和r共享引用计数，但指向p(比如r管理对象的一个成员)
+	template <typename U>
+	shared_ptr(const shared_ptr<U, Policy>& r, T* p);
+	template <typename U>
+	shared_ptr(shared_ptr<U, Policy>&& r, T* p) noexcept;
+	//从weak_ptr构造，对象已经释放时抛异常
+	template <typename U, typename = convertible<U>>
+	explicit shared_ptr(const weak_ptr<U, Policy>&);
+	//deleter可以是任意可调用对象，比如std::function<void(T*)>或lambda
+	template <typename D>
+	shared_ptr(T*, D);
 	shared_ptr& operator=(const shared_ptr&);
+	shared_ptr& operator=(shared_ptr&&) noexcept;
 	//重写解引用和取值方法
 	T& operator*() const;
 	T* operator->() const;
@@ -23,93 +228,230 @@ public:
 	// 向bool的类型转换
 	explicit operator bool() const;
 
-	bool unique();
+	bool unique() const;
+	long use_count() const;
 	void reset();
 	void reset(T*);
-	void reset(T*, std::function<void(T*)>);
+	template <typename D>
+	void reset(T*, D);
 	T* release();
+	void swap(shared_ptr&) noexcept;
 
 	T* get() const;
 
+	// 内部使用：接管一个已经计过数的控制块
+	shared_ptr(T* p, ctrl_type* ctrl, detail::ctrl_tag) : m_pobject(p), m_pctrl(ctrl)
+	{
+		enable_shared_from(p);
+	}
+
 private:
-	// 默认的deleter
-	static std::function<void(T*)> default_del;
+	// T继承enable_shared_from_this时，记下自己的weak_ptr
+	template <typename U>
+	void enable_shared_from(const enable_shared_from_this<U, Policy>* base);
+	void enable_shared_from(...) {}
+
+	// 计数减1，没有其他用户时释放对象和控制块
+	void dec_ref();
 
 private:
-	unsigned* m_p_use_count = nullptr; //引用计数
 	T* m_pobject = nullptr;  //实际指针
-	std::function<void(T*)> m_del = default_del;  //deleter
+	ctrl_type* m_pctrl = nullptr; //控制块(引用计数 + deleter)，空指针时没有控制块
 };
 
-//默认的deleter是delete调用析构，然后设置内部指针为nullptr
+// 非原子计数的版本，只在单线程的热路径上使用
 template <typename T>
-std::function<void(T*)> shared_ptr<T>::default_del = [](T*p) {delete p; p = nullptr; };
+using local_shared_ptr = shared_ptr<T, local_count>;
 
+namespace detail{
+template <typename T, typename Policy, typename... Args>
+shared_ptr<T, Policy> make_shared_impl(Args&&... args)
+{
+	auto ctrl = new ctrl_block_inplace<T, Policy>(std::forward<Args>(args)...);
+	return shared_ptr<T, Policy>(ctrl->get(), ctrl, ctrl_tag());
+}
+
+template <typename T, typename Policy, typename A, typename... Args>
+shared_ptr<T, Policy> allocate_shared_impl(const A& a, Args&&... args)
+{
+	typedef ctrl_block_inplace_alloc<T, A, Policy> block_type;
+	typename block_type::alloc_type alloc(a);
+	block_type* ctrl = block_type::alloc_traits::allocate(alloc, 1);
+	try
+	{
+		::new (static_cast<void*>(ctrl)) block_type(a, std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		block_type::alloc_traits::deallocate(alloc, ctrl, 1);
+		throw;
+	}
+	return shared_ptr<T, Policy>(ctrl->get(), ctrl, ctrl_tag());
+}
+} // namespace detail
 
 //可变模板参数，作为初始化内部对象的参数
 //万能引用作为形参，一定要做完美转发！！！
+//对象和控制块一次分配
 template <typename T, typename... Args>
 shared_ptr<T> make_shared(Args&&... args)
 {
-	shared_ptr<T> sp(new T(std::forward<Args>(args)...));
-	return sp;
+	return detail::make_shared_impl<T, atomic_count>(std::forward<Args>(args)...);
 }
 
+template <typename T, typename... Args>
+local_shared_ptr<T> make_local_shared(Args&&... args)
+{
+	return detail::make_shared_impl<T, local_count>(std::forward<Args>(args)...);
+}
 
-template <typename T>
-shared_ptr<T>::shared_ptr()
-	:m_pobject(nullptr), m_p_use_count(new unsigned(1))
+//和make_shared一样一次分配，对象和控制块的内存由allocator a提供(比如alloc::slab_allocator)
+template <typename T, typename A, typename... Args>
+shared_ptr<T> allocate_shared(const A& a, Args&&... args)
 {
+	return detail::allocate_shared_impl<T, atomic_count>(a, std::forward<Args>(args)...);
 }
 
+template <typename T, typename A, typename... Args>
+local_shared_ptr<T> allocate_local_shared(const A& a, Args&&... args)
+{
+	return detail::allocate_shared_impl<T, local_count>(a, std::forward<Args>(args)...);
+}
 
-template <typename T>
-shared_ptr<T>::shared_ptr(T *p)
-	:m_pobject(p), m_p_use_count(new unsigned(1))
+//和std::get_deleter一样：sp的deleter类型是D时返回它的地址，否则(包括make_shared的对象)返回nullptr
+template <typename D, typename T, typename Policy>
+D* get_deleter(const shared_ptr<T, Policy>& sp) noexcept
 {
+	return sp.m_pctrl == nullptr ? nullptr : static_cast<D*>(sp.m_pctrl->get_deleter(typeid(D)));
 }
 
+template <typename T, typename Policy>
+shared_ptr<T, Policy>::shared_ptr()
+	:m_pobject(nullptr), m_pctrl(nullptr)
+{
+}
 
-template <typename T>
-shared_ptr<T>::shared_ptr(T *p, std::function<void(T*)> del)
-	:m_pobject(p), m_p_use_count(new unsigned(1)), m_del(del)
+
+template <typename T, typename Policy>
+shared_ptr<T, Policy>::shared_ptr(T *p)
+	:m_pobject(p), m_pctrl(nullptr)
+{
+	if (p != nullptr)
+	{
+		m_pctrl = new detail::ctrl_block_ptr<T, detail::default_delete<T>, Policy>(p, detail::default_delete<T>());
+		enable_shared_from(p);
+	}
+}
+
+
+template <typename T, typename Policy>
+template <typename D>
+shared_ptr<T, Policy>::shared_ptr(T *p, D del)
+	:m_pobject(p), m_pctrl(new detail::ctrl_block_ptr<T, D, Policy>(p, std::move(del)))
 {
+	enable_shared_from(p);
 }
 
 //拷贝构造函数，要给引用计数加1（并且是所有shared_ptr的引用计数）
-template <typename T>
-shared_ptr<T>::shared_ptr(const shared_ptr& rhs)
-	:m_pobject(rhs.m_pobject), m_p_use_count(rhs.m_p_use_count), m_del(rhs.m_del)
+template <typename T, typename Policy>
+shared_ptr<T, Policy>::shared_ptr(const shared_ptr& rhs)
+	:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
 {
-	(*m_p_use_count)++;
+	if (m_pctrl != nullptr)
+	{
+		m_pctrl->add_ref();
+	}
 }
 
-//拷贝赋值函数，用参数的内部指针把本指针内部指针置换出来(引用计数做相应的增加和减少)
-template <typename T>
-shared_ptr<T>& shared_ptr<T>::operator =(const shared_ptr &rhs)
+template <typename T, typename Policy>
+shared_ptr<T, Policy>::shared_ptr(shared_ptr&& rhs) noexcept
+	:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
 {
-	// 使用rhs的deleter
-	m_del = rhs.m_del;
-	// 递增右侧运算对象的引用计数
-	++(*rhs.m_p_use_count);
-	// 递减本对象的引用计数
-	if (--(*m_p_use_count) == 0)
+	rhs.m_pobject = nullptr;
+	rhs.m_pctrl = nullptr;
+}
+
+template <typename T, typename Policy>
+template <typename U, typename>
+shared_ptr<T, Policy>::shared_ptr(const shared_ptr<U, Policy>& rhs)
+	:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
+{
+	if (m_pctrl != nullptr)
 	{
-		// 如果管理的对象没有其他用户了，则释放对象分配的成员
-		m_del(m_pobject);
-		
-		delete m_p_use_count;
+		m_pctrl->add_ref();
 	}
+}
+
+template <typename T, typename Policy>
+template <typename U, typename>
+shared_ptr<T, Policy>::shared_ptr(shared_ptr<U, Policy>&& rhs) noexcept
+	:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
+{
+	rhs.m_pobject = nullptr;
+	rhs.m_pctrl = nullptr;
+}
+
+template <typename T, typename Policy>
+template <typename U>
+shared_ptr<T, Policy>::shared_ptr(const shared_ptr<U, Policy>& r, T* p)
+	:m_pobject(p), m_pctrl(r.m_pctrl)
+{
+	if (m_pctrl != nullptr)
+	{
+		m_pctrl->add_ref();
+	}
+}
+
+template <typename T, typename Policy>
+template <typename U>
+shared_ptr<T, Policy>::shared_ptr(shared_ptr<U, Policy>&& r, T* p) noexcept
+	:m_pobject(p), m_pctrl(r.m_pctrl)
+{
+	r.m_pobject = nullptr;
+	r.m_pctrl = nullptr;
+}
 
-	m_p_use_count = rhs.m_p_use_count;
-	m_pobject = rhs.m_pobject;
+template <typename T, typename Policy>
+template <typename U, typename>
+shared_ptr<T, Policy>::shared_ptr(const weak_ptr<U, Policy>& rhs)
+	:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
+{
+	if (m_pctrl == nullptr || !m_pctrl->add_ref_lock())
+	{
+		throw std::logic_error("bad_weak_ptr: object already released");
+	}
+}
 
+//拷贝赋值函数，用参数的内部指针把本指针内部指针置换出来(引用计数做相应的增加和减少)
+//先拷贝出一个临时对象再交换，自赋值时也不会提前释放
+template <typename T, typename Policy>
+shared_ptr<T, Policy>& shared_ptr<T, Policy>::operator =(const shared_ptr &rhs)
+{
+	shared_ptr(rhs).swap(*this);
 	return *this; // 返回本对象
 }
 
+//移动赋值：旧对象的计数在临时对象析构时减掉
+template <typename T, typename Policy>
+shared_ptr<T, Policy>& shared_ptr<T, Policy>::operator =(shared_ptr &&rhs) noexcept
+{
+	shared_ptr(std::move(rhs)).swap(*this);
+	return *this;
+}
+
+template <typename T, typename Policy>
+void shared_ptr<T, Policy>::dec_ref()
+{
+	// 如果管理的对象没有其他用户了，则释放对象，没有weak引用时再释放控制块
+	if (m_pctrl != nullptr)
+	{
+		m_pctrl->release();
+	}
+}
+
 //解引用直接返回内部指针的解引用
-template <typename T>
-T& shared_ptr<T>::operator*() const
+template <typename T, typename Policy>
+T& shared_ptr<T, Policy>::operator*() const
 {
 	return *m_pobject;
 }
@@ -120,104 +462,244 @@ T& shared_ptr<T>::operator*() const
 //1.如果x是指针，那么等价于(*x).y
 //2.如果x是类对象，那么等价于(m = x.operator->()).y。如果m是指针，那么和上述类似；
 //  如果m还含有operator->()的重载，那么将重复调用这个过程
-template <typename T>
-T* shared_ptr<T>::operator->() const
+template <typename T, typename Policy>
+T* shared_ptr<T, Policy>::operator->() const
 {
 	return &this->operator*();
 }
 
 //计算引用计数，不足则析构
-template <typename T>
-shared_ptr<T>::~shared_ptr()
+template <typename T, typename Policy>
+shared_ptr<T, Policy>::~shared_ptr()
 {
-	if (--(*m_p_use_count) == 0)
-	{
-		m_del(m_pobject);
-		m_pobject = nullptr;
+	dec_ref();
+}
 
-		delete m_p_use_count;
-		m_p_use_count = nullptr;
-	}
+//是否独占内部指针，即引用计数为1
+template <typename T, typename Policy>
+bool shared_ptr<T, Policy>::unique() const
+{
+	return use_count() == 1;
 }
 
-//独占内部指针，即引用计数设为1
-template <typename T>
-bool shared_ptr<T>::unique()
+template <typename T, typename Policy>
+long shared_ptr<T, Policy>::use_count() const
 {
-	return *m_p_use_count == 1;
+	return m_pctrl != nullptr ? Policy::load(m_pctrl->use_count) : 0;
 }
 
 //重置本智能指针
-template <typename T>
-void shared_ptr<T>::reset()
+template <typename T, typename Policy>
+void shared_ptr<T, Policy>::reset()
 {
-	(*m_p_use_count)--;
-
-	if (*m_p_use_count == 0)
-	{
-		m_del(m_pobject);
-	}
-
-	m_pobject = nullptr;
-	*m_p_use_count = 1;
-	m_del = default_del;
+	shared_ptr().swap(*this);
 }
 
 //重置本智能指针，用p替换内部指针
-template <typename T>
-void shared_ptr<T>::reset(T* p)
+template <typename T, typename Policy>
+void shared_ptr<T, Policy>::reset(T* p)
 {
-	(*m_p_use_count)--;
-
-	if (*m_p_use_count == 0)
-	{
-		m_del(m_pobject);
-	}
-
-	m_pobject = p;
-	*m_p_use_count = 1;
-	m_del = default_del;
+	shared_ptr(p).swap(*this);
 }
 
 //重置智能指针，并设置deleter
-template <typename T>
-void shared_ptr<T>::reset(T *p, std::function<void(T*)> del)
+template <typename T, typename Policy>
+template <typename D>
+void shared_ptr<T, Policy>::reset(T *p, D del)
 {
-	reset(p);
-	m_del = del;
+	shared_ptr(p, std::move(del)).swap(*this);
 }
 
 //释放内部指针，并返回
-//若引用计数到0，也不delete内部指针
-template <typename T>
-T* shared_ptr<T>::release()
+//若引用计数到0，也不delete内部指针，只释放控制块
+//make_shared的对象在控制块里，不能单独交给调用方delete
+template <typename T, typename Policy>
+T* shared_ptr<T, Policy>::release()
 {
-	(*m_p_use_count)--;
-
-	//这里重置为1
-	if (*m_p_use_count == 0)
+	if (m_pctrl != nullptr && m_pctrl->inplace())
+	{
+		throw std::logic_error("release() on a pointer created by make_shared");
+	}
+	if (m_pctrl != nullptr && Policy::dec(m_pctrl->use_count) == 0)
 	{
-		*m_p_use_count = 1;
+		m_pctrl->weak_release();
 	}
 
 	auto p = m_pobject;
 	m_pobject = nullptr;
+	m_pctrl = nullptr;
 
 	return p;
 }
 
+template <typename T, typename Policy>
+void shared_ptr<T, Policy>::swap(shared_ptr& rhs) noexcept
+{
+	std::swap(m_pobject, rhs.m_pobject);
+	std::swap(m_pctrl, rhs.m_pctrl);
+}
 
-template <typename T>
-T* shared_ptr<T>::get() const
+
+template <typename T, typename Policy>
+T* shared_ptr<T, Policy>::get() const
 {
 	return m_pobject;
 }
 
 
-template <typename T>
-shared_ptr<T>::operator bool() const
+template <typename T, typename Policy>
+shared_ptr<T, Policy>::operator bool() const
 {
 	return m_pobject != nullptr;
 }
 
-} // namespace smart_ptr
\ No newline at end of file
+
+// 不增加use_count的观察者，用来打破循环引用
+// 只持有控制块的weak计数，对象释放后控制块还在，lock()会返回空指针
+template <typename T, typename Policy = atomic_count>
+class weak_ptr
+{
+	typedef detail::ctrl_block<Policy> ctrl_type;
+
+	template <typename U, typename P>
+	friend class shared_ptr;
+	template <typename U, typename P>
+	friend class weak_ptr;
+
+public:
+	weak_ptr() noexcept {}
+
+	template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+	weak_ptr(const shared_ptr<U, Policy>& rhs) noexcept
+		:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
+	{
+		if (m_pctrl != nullptr)
+		{
+			m_pctrl->weak_add_ref();
+		}
+	}
+
+	weak_ptr(const weak_ptr& rhs) noexcept
+		:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
+	{
+		if (m_pctrl != nullptr)
+		{
+			m_pctrl->weak_add_ref();
+		}
+	}
+
+	weak_ptr(weak_ptr&& rhs) noexcept
+		:m_pobject(rhs.m_pobject), m_pctrl(rhs.m_pctrl)
+	{
+		rhs.m_pobject = nullptr;
+		rhs.m_pctrl = nullptr;
+	}
+
+	~weak_ptr()
+	{
+		if (m_pctrl != nullptr)
+		{
+			m_pctrl->weak_release();
+		}
+	}
+
+	weak_ptr& operator=(const weak_ptr& rhs) noexcept
+	{
+		weak_ptr(rhs).swap(*this);
+		return *this;
+	}
+
+	weak_ptr& operator=(weak_ptr&& rhs) noexcept
+	{
+		weak_ptr(std::move(rhs)).swap(*this);
+		return *this;
+	}
+
+	template <typename U>
+	weak_ptr& operator=(const shared_ptr<U, Policy>& rhs) noexcept
+	{
+		weak_ptr(rhs).swap(*this);
+		return *this;
+	}
+
+	// 对象还活着时返回一个shared_ptr，否则返回空指针
+	shared_ptr<T, Policy> lock() const noexcept
+	{
+		if (m_pctrl != nullptr && m_pctrl->add_ref_lock())
+		{
+			return shared_ptr<T, Policy>(m_pobject, m_pctrl, detail::ctrl_tag());
+		}
+		return shared_ptr<T, Policy>();
+	}
+
+	bool expired() const noexcept
+	{
+		return use_count() == 0;
+	}
+
+	long use_count() const noexcept
+	{
+		return m_pctrl != nullptr ? Policy::load(m_pctrl->use_count) : 0;
+	}
+
+	void reset() noexcept
+	{
+		weak_ptr().swap(*this);
+	}
+
+	void swap(weak_ptr& rhs) noexcept
+	{
+		std::swap(m_pobject, rhs.m_pobject);
+		std::swap(m_pctrl, rhs.m_pctrl);
+	}
+
+private:
+	T* m_pobject = nullptr;
+	ctrl_type* m_pctrl = nullptr;
+};
+
+// 继承它的类可以在成员函数里拿到管理自己的shared_ptr
+// 对象第一次交给shared_ptr管理时(构造或make_shared)记下weak_ptr
+template <typename T, typename Policy = atomic_count>
+class enable_shared_from_this
+{
+	template <typename U, typename P>
+	friend class shared_ptr;
+
+public:
+	shared_ptr<T, Policy> shared_from_this()
+	{
+		return shared_ptr<T, Policy>(m_weak_this);
+	}
+
+	shared_ptr<const T, Policy> shared_from_this() const
+	{
+		return shared_ptr<const T, Policy>(m_weak_this);
+	}
+
+	weak_ptr<T, Policy> weak_from_this() const noexcept
+	{
+		return m_weak_this;
+	}
+
+protected:
+	enable_shared_from_this() noexcept {}
+	enable_shared_from_this(const enable_shared_from_this&) noexcept {}
+	enable_shared_from_this& operator=(const enable_shared_from_this&) noexcept { return *this; }
+	~enable_shared_from_this() {}
+
+private:
+	mutable weak_ptr<T, Policy> m_weak_this;
+};
+
+template <typename T, typename Policy>
+template <typename U>
+void shared_ptr<T, Policy>::enable_shared_from(const enable_shared_from_this<U, Policy>* base)
+{
+	if (base != nullptr && base->m_weak_this.expired())
+	{
+		base->m_weak_this = shared_ptr<U, Policy>(*this, const_cast<U*>(static_cast<const U*>(base)));
+	}
+}
+
+} // namespace smart_ptr
@@ -1,5 +1,7 @@
 #include "shared_ptr.h"
+#include <cassert>
 #include <iostream>
+#include <stdexcept>
 using std::cout;
 using std::endl;
 
@@ -11,8 +13,129 @@ struct MyStruct
 	int b;
 };
 
+struct Base
+{
+	virtual ~Base() {}
+	int id = 1;
+};
+
+struct Derived : Base
+{
+	Derived() { alive++; }
+	~Derived() { alive--; }
+	static int alive;
+};
+int Derived::alive = 0;
+
+//循环引用：parent持有child的shared_ptr，child只用weak_ptr指回parent
+struct TreeNode
+{
+	TreeNode() { alive++; }
+	~TreeNode() { alive--; }
+	smart_ptr::shared_ptr<TreeNode> child;
+	smart_ptr::weak_ptr<TreeNode> parent;
+	static int alive;
+};
+int TreeNode::alive = 0;
+
+struct Session : smart_ptr::enable_shared_from_this<Session>
+{
+	smart_ptr::shared_ptr<Session> self() { return shared_from_this(); }
+};
+
+void test_weak_ptr()
+{
+	smart_ptr::weak_ptr<MyStruct> weak;
+	{
+		auto sp = smart_ptr::make_shared<MyStruct>(1, 2);
+		weak = sp;
+		assert(weak.use_count() == 1 && !weak.expired());
+		auto locked = weak.lock();
+		assert(locked && locked->a == 1 && sp.use_count() == 2);
+	}
+	//对象已经释放：lock()返回空，从weak_ptr构造shared_ptr抛异常
+	assert(weak.expired());
+	assert(!weak.lock());
+	bool threw = false;
+	try
+	{
+		smart_ptr::shared_ptr<MyStruct> sp(weak);
+	}
+	catch (const std::logic_error&)
+	{
+		threw = true;
+	}
+	assert(threw);
+	cout << "weak_ptr ok" << endl;
+}
+
+void test_cycle()
+{
+	{
+		auto parent = smart_ptr::make_shared<TreeNode>();
+		auto child = smart_ptr::make_shared<TreeNode>();
+		parent->child = child;
+		child->parent = parent;
+		assert(parent.use_count() == 1 && child.use_count() == 2);
+		assert(child->parent.lock().get() == parent.get());
+	}
+	//weak_ptr不占use_count，两个节点都被释放
+	assert(TreeNode::alive == 0);
+	cout << "cycle ok" << endl;
+}
+
+void test_shared_from_this()
+{
+	auto sp = smart_ptr::make_shared<Session>();
+	auto self = sp->self();
+	assert(self.get() == sp.get() && sp.use_count() == 2);
+	assert(sp->weak_from_this().lock().get() == sp.get());
+
+	//没有交给shared_ptr管理的对象拿不到shared_ptr
+	Session local;
+	bool threw = false;
+	try
+	{
+		local.self();
+	}
+	catch (const std::logic_error&)
+	{
+		threw = true;
+	}
+	assert(threw);
+	cout << "enable_shared_from_this ok" << endl;
+}
+
+void test_aliasing_and_converting()
+{
+	{
+		//别名：指向成员，但和整个对象共享计数
+		auto whole = smart_ptr::make_shared<MyStruct>(7, 8);
+		smart_ptr::shared_ptr<int> member(whole, &whole->b);
+		assert(*member == 8 && whole.use_count() == 2);
+		whole.reset();
+		assert(*member == 8 && member.use_count() == 1);
+
+		//派生类转基类：共用同一个控制块，释放时调用Derived的析构
+		smart_ptr::shared_ptr<Derived> derived(new Derived());
+		smart_ptr::shared_ptr<Base> base(derived);
+		assert(base.get() == derived.get() && derived.use_count() == 2);
+		derived.reset();
+		assert(Derived::alive == 1 && base->id == 1);
+		smart_ptr::shared_ptr<Base> moved(std::move(base));
+		assert(!base && moved.use_count() == 1);
+	}
+	assert(Derived::alive == 0);
+	cout << "aliasing/converting ok" << endl;
+}
+
 int main()
 {
+	test_weak_ptr();
+	test_cycle();
+	test_shared_from_this();
+	test_aliasing_and_converting();
+
 	MyStruct *s = new MyStruct();
 	s->a = 10;
 	s->b = 20;
@@ -33,11 +156,11 @@ int main()
 	cout << sp3->b << endl;
 
 
-	auto p = sp2.release();
+	//make_shared的对象和控制块在同一块内存里，不能release出来自己delete
+	auto p = sp.release();
 	cout << p->a << endl;
 	cout << p->b << endl;
-    
-    sp3.release();
+
 	delete p;
 
 	return 0;
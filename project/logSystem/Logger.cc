@@ -17,6 +17,7 @@ Logger::Logger(){
 
 }
 
+//单例在进程退出(或single::shutdown())时销毁，close会把缓冲里的内容刷到文件
 Logger::~Logger(){
     closeFile();
 }
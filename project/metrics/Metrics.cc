@@ -0,0 +1,338 @@
+#include "Metrics.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace metrics;
+
+void detail::sumCells(uint32_t cell, uint32_t n, uint64_t* out){
+    std::memset(out, 0, sizeof(uint64_t) * n);
+    ThreadShards::visit([&](const ThreadCells& cells){
+        for(uint32_t i = 0; i < n; i++){
+            out[i] += cells.load(cell + i);
+        }
+    });
+}
+
+uint64_t Counter::value() const{
+    uint64_t value = 0;
+    detail::sumCells(cell_, 1, &value);
+    return value;
+}
+
+uint64_t Histogram::bucketLower(int index){
+    if(index < kSubBuckets){
+        return (uint64_t)index;
+    }
+    int exponent = index / kSubBuckets + kSubBits - 1;
+    return (uint64_t)(kSubBuckets + index % kSubBuckets) << (exponent - kSubBits);
+}
+
+uint64_t Histogram::bucketUpper(int index){
+    if(index < kSubBuckets){
+        return (uint64_t)index + 1;
+    }
+    int exponent = index / kSubBuckets + kSubBits - 1;
+    return bucketLower(index) + ((uint64_t)1 << (exponent - kSubBits));
+}
+
+HistogramSnapshot Histogram::snapshot() const{
+    HistogramSnapshot snapshot;
+    std::vector<uint64_t> cells(kBuckets + 1);
+    detail::sumCells(cell_, kBuckets + 1, cells.data());
+    snapshot.buckets_.assign(cells.begin(), cells.begin() + kBuckets);
+    snapshot.sum_ = cells[kBuckets];
+    return snapshot;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other){
+    for(size_t i = 0; i < buckets_.size(); i++){
+        buckets_[i] += other.buckets_[i];
+    }
+    sum_ += other.sum_;
+}
+
+uint64_t HistogramSnapshot::count() const{
+    uint64_t count = 0;
+    for(uint64_t n : buckets_){
+        count += n;
+    }
+    return count;
+}
+
+double HistogramSnapshot::mean() const{
+    uint64_t n = count();
+    return n == 0 ? 0 : (double)sum_ / n;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const{
+    uint64_t n = count();
+    if(n == 0){
+        return 0;
+    }
+    //最近秩：第ceil(q*n)个(从1开始)值落在哪个桶，减去一点是为了0.3*10这样的乘积不会因为舍入多算一个
+    uint64_t rank = (uint64_t)std::ceil(q * n - 1e-9);
+    if(rank < 1){
+        rank = 1;
+    }
+    if(rank > n){
+        rank = n;
+    }
+    uint64_t seen = 0;
+    for(int i = 0; i < Histogram::kBuckets; i++){
+        seen += buckets_[i];
+        if(seen >= rank){
+            return Histogram::bucketUpper(i) - 1;
+        }
+    }
+    return Histogram::bucketUpper(Histogram::kBuckets - 1) - 1;
+}
+
+//Prometheus的指标名：[a-zA-Z_:][a-zA-Z0-9_:]*
+static bool validName(const std::string& name){
+    if(name.empty()){
+        return false;
+    }
+    for(size_t i = 0; i < name.size(); i++){
+        char c = name[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+        if(!ok){
+            return false;
+        }
+    }
+    return true;
+}
+
+Registry::Family& Registry::family(const std::string& name, const std::string& help, Type type, bool& created){
+    if(!validName(name)){
+        throw std::logic_error("invalid metric name: " + name);
+    }
+    auto it = families_.find(name);
+    created = it == families_.end();
+    if(created){
+        it = families_.emplace(name, Family()).first;
+        it->second.type = type;
+        it->second.help = help;
+    }else if(it->second.type != type){
+        throw std::logic_error("metric registered with another type: " + name);
+    }
+    return it->second;
+}
+
+//一个指标的单元不能跨块，放不下就从下一块开始
+uint32_t Registry::allocCells(uint32_t n){
+    uint32_t offset = nextCell_ & (detail::kChunkCells - 1);
+    if(offset + n > detail::kChunkCells){
+        nextCell_ += detail::kChunkCells - offset;
+    }
+    if(nextCell_ + n > detail::kChunkCells * detail::kMaxChunks){
+        throw std::logic_error("too many metrics");
+    }
+    uint32_t cell = nextCell_;
+    nextCell_ += n;
+    return cell;
+}
+
+Counter& Registry::counter(const std::string& name, const std::string& help){
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Family& f = family(name, help, COUNTER, created);
+    if(created){
+        f.counter.reset(new Counter(allocCells(1)));
+    }
+    return *f.counter;
+}
+
+Gauge& Registry::gauge(const std::string& name, const std::string& help){
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Family& f = family(name, help, GAUGE, created);
+    if(created){
+        f.gauge.reset(new Gauge());
+    }
+    return *f.gauge;
+}
+
+Histogram& Registry::histogram(const std::string& name, const std::string& help){
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Family& f = family(name, help, HISTOGRAM, created);
+    if(created){
+        f.histogram.reset(new Histogram(allocCells(Histogram::kBuckets + 1)));
+    }
+    return *f.histogram;
+}
+
+void Registry::gaugeCallback(const std::string& name, const std::string& help, std::function<double()> func){
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool created;
+    Family& f = family(name, help, GAUGE_CALLBACK, created);
+    f.callback = std::move(func);
+}
+
+//直方图按2的幂输出累计桶：le是整数值，取区间[0, 2^k)的上界(含)2^k - 1，
+//到最后一个非空的区间为止，后面只跟+Inf
+//最后一个桶还装着所有>= 2^kMaxExponent的值，不能给它有限的le，这些值只算进+Inf
+static void dumpHistogram(std::ostringstream& out, const std::string& name, const HistogramSnapshot& snapshot){
+    const std::vector<uint64_t>& buckets = snapshot.buckets();
+    int last = Histogram::kBuckets - 1;
+    while(last > 0 && buckets[last] == 0){
+        last--;
+    }
+    uint64_t cumulative = 0;
+    for(int i = 0; i < Histogram::kBuckets - 1; i++){
+        cumulative += buckets[i];
+        uint64_t upper = Histogram::bucketUpper(i);
+        bool octave = upper >= (uint64_t)Histogram::kSubBuckets && (upper & (upper - 1)) == 0;
+        if(octave){
+            out << name << "_bucket{le=\"" << upper - 1 << "\"} " << cumulative << "\n";
+            if(i >= last){
+                break;
+            }
+        }
+    }
+    out << name << "_bucket{le=\"+Inf\"} " << snapshot.count() << "\n";
+    out << name << "_sum " << snapshot.sum() << "\n";
+    out << name << "_count " << snapshot.count() << "\n";
+}
+
+//HELP里的反斜杠和换行要转义，否则一条HELP会被解析成多行
+static std::string escapeHelp(const std::string& help){
+    std::string escaped;
+    escaped.reserve(help.size());
+    for(char c : help){
+        if(c == '\\'){
+            escaped += "\\\\";
+        }else if(c == '\n'){
+            escaped += "\\n";
+        }else{
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string Registry::dump() const{
+    //先在锁里拷贝出所有指标，再在锁外取值：回调可能很慢，也可能在里面注册别的指标
+    //指标对象注册后不会释放，锁外读是安全的
+    struct Item{
+        std::string name;
+        std::string help;
+        Type type;
+        const Counter* counter;
+        const Gauge* gauge;
+        const Histogram* histogram;
+        std::function<double()> callback;
+    };
+    std::vector<Item> items;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items.reserve(families_.size());
+        for(const auto& item : families_){
+            const Family& f = item.second;
+            items.push_back({item.first, f.help, f.type, f.counter.get(), f.gauge.get(), f.histogram.get(), f.callback});
+        }
+    }
+
+    std::ostringstream out;
+    for(const Item& item : items){
+        const std::string& name = item.name;
+        if(!item.help.empty()){
+            out << "# HELP " << name << " " << escapeHelp(item.help) << "\n";
+        }
+        switch(item.type){
+        case COUNTER:
+            out << "# TYPE " << name << " counter\n" << name << " " << item.counter->value() << "\n";
+            break;
+        case GAUGE:
+            out << "# TYPE " << name << " gauge\n" << name << " " << item.gauge->value() << "\n";
+            break;
+        case GAUGE_CALLBACK:
+            out << "# TYPE " << name << " gauge\n" << name << " " << item.callback() << "\n";
+            break;
+        case HISTOGRAM:
+            out << "# TYPE " << name << " histogram\n";
+            dumpHistogram(out, name, item.histogram->snapshot());
+            break;
+        }
+    }
+    return out.str();
+}
+
+void Registry::dumpToFile(const std::string& filename) const{
+    std::string text = dump();
+    //临时文件名用mkstemp生成，多个进程/线程同时导出到同一个文件时不会互相覆盖临时文件
+    std::string tmp = filename + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if(fd < 0){
+        throw std::logic_error("create temp file failed: " + tmp);
+    }
+    const char* p = text.data();
+    size_t left = text.size();
+    while(left > 0){
+        ssize_t n = write(fd, p, left);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            close(fd);
+            unlink(tmp.c_str());
+            throw std::logic_error("write file failed: " + tmp);
+        }
+        p += n;
+        left -= n;
+    }
+    //mkstemp建的文件是0600，改成和普通文件一样可读
+    fchmod(fd, 0644);
+    //先落盘再改名，掉电后不会看到改过名但内容为空的文件
+    if(fsync(fd) != 0){
+        close(fd);
+        unlink(tmp.c_str());
+        throw std::logic_error("fsync file failed: " + tmp);
+    }
+    close(fd);
+    if(rename(tmp.c_str(), filename.c_str()) != 0){
+        unlink(tmp.c_str());
+        throw std::logic_error("rename metrics file failed: " + filename);
+    }
+}
+
+void Registry::dumpToSocket(const std::string& path) const{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)){
+        throw std::logic_error("socket path too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0){
+        throw std::logic_error("create socket failed");
+    }
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0){
+        close(fd);
+        throw std::logic_error("connect socket failed: " + path);
+    }
+    std::string text = dump();
+    const char* p = text.data();
+    size_t left = text.size();
+    while(left > 0){
+        ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+        if(n <= 0){
+            close(fd);
+            throw std::logic_error("write socket failed: " + path);
+        }
+        p += n;
+        left -= n;
+    }
+    close(fd);
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../dp&&ds/singleton/thread_local_singleton.h"
+
+//指标库：计数器、仪表、对数线性直方图，导出成Prometheus文本格式
+//计数器和直方图按线程分片：每个线程只改自己的那份(一次relaxed的load+store，没有lock前缀的指令，不争用cache line)，
+//读的时候把所有线程的分片加起来；线程退出后分片留给下一个新线程接着累加，数值不会丢
+//用法：
+//    static metrics::Counter& lookups = metrics::Registry::get().counter("reflect_lookups_total", "class lookups");
+//    lookups.inc();
+//    static metrics::Histogram& latency = metrics::Registry::get().histogram("log_write_ns", "log write latency in ns");
+//    { metrics::ScopedTimer timer(latency); ... }
+namespace metrics{
+
+namespace detail{
+
+//每个线程的分片：按块分配的计数单元，块在第一次用到时由本线程分配，之后不释放
+//每个计数器占一个单元，每个直方图占一段连续的单元(都在同一块里)
+const uint32_t kChunkBits = 12;
+const uint32_t kChunkCells = 1u << kChunkBits;
+const uint32_t kMaxChunks = 256;
+
+struct ThreadCells{
+    std::atomic<std::atomic<uint64_t>*> chunks[kMaxChunks]{};
+
+    std::atomic<uint64_t>* chunk(uint32_t cell){
+        std::atomic<uint64_t>* c = chunks[cell >> kChunkBits].load(std::memory_order_relaxed);
+        if(c == nullptr){
+            c = new std::atomic<uint64_t>[kChunkCells]();
+            chunks[cell >> kChunkBits].store(c, std::memory_order_release);
+        }
+        return c + (cell & (kChunkCells - 1));
+    }
+
+    //其他线程读
+    uint64_t load(uint32_t cell) const{
+        std::atomic<uint64_t>* c = chunks[cell >> kChunkBits].load(std::memory_order_acquire);
+        return c == nullptr ? 0 : c[cell & (kChunkCells - 1)].load(std::memory_order_relaxed);
+    }
+};
+
+//槽位复用时必须保留数据，否则已退出线程计过的数会从汇总结果里消失
+typedef single::ThreadLocalSingleton<ThreadCells, single::KeepOnReuse> ThreadShards;
+
+//当前线程分片里的第cell个单元
+inline std::atomic<uint64_t>* localCell(uint32_t cell){
+    return ThreadShards::instance()->chunk(cell);
+}
+
+//只有本线程写，不需要原子加
+inline void bump(std::atomic<uint64_t>& c, uint64_t n){
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+//所有线程分片里[cell, cell + n)的和
+void sumCells(uint32_t cell, uint32_t n, uint64_t* out);
+
+} // namespace detail
+
+//只增不减的计数器
+class Counter{
+public:
+    explicit Counter(uint32_t cell) : cell_(cell) {}
+    void inc(uint64_t n = 1){
+        detail::bump(*detail::localCell(cell_), n);
+    }
+    uint64_t value() const;
+private:
+    uint32_t cell_;
+};
+
+//可增可减、可以直接设置的值(队列长度、连接数)，所有线程共用一个原子变量
+class alignas(64) Gauge{
+public:
+    void set(int64_t value){ value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t n = 1){ value_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(int64_t n = 1){ value_.fetch_sub(n, std::memory_order_relaxed); }
+    int64_t value() const{ return value_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+//对数线性分桶：每个2的幂区间均分成16个桶，相对误差不超过1/16
+//小于16的值每个值一个桶，不小于2^40的值(按纳秒算约18分钟)都算进最后一个桶
+class HistogramSnapshot;
+
+class Histogram{
+public:
+    static const int kSubBits = 4;
+    static const int kSubBuckets = 1 << kSubBits;
+    static const int kMaxExponent = 40;
+    static const int kBuckets = (kMaxExponent - kSubBits + 1) * kSubBuckets;
+
+    static int bucketIndex(uint64_t value){
+        if(value < (uint64_t)kSubBuckets){
+            return (int)value;
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        if(exponent >= kMaxExponent){
+            return kBuckets - 1;
+        }
+        return (exponent - kSubBits + 1) * kSubBuckets + (int)((value >> (exponent - kSubBits)) & (kSubBuckets - 1));
+    }
+    //第index个桶的范围是[bucketLower, bucketUpper)
+    static uint64_t bucketLower(int index);
+    static uint64_t bucketUpper(int index);
+
+    explicit Histogram(uint32_t cell) : cell_(cell) {}
+
+    //桶和总和在同一块里，只取一次线程分片
+    void record(uint64_t value){
+        std::atomic<uint64_t>* cells = detail::localCell(cell_);
+        detail::bump(cells[bucketIndex(value)], 1);
+        detail::bump(cells[kBuckets], value);
+    }
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    uint32_t cell_;  //kBuckets个桶 + 总和
+};
+
+//合并后的直方图，可以继续和别的快照合并(比如多个进程的数据)
+class HistogramSnapshot{
+public:
+    HistogramSnapshot() : buckets_(Histogram::kBuckets, 0) {}
+
+    void merge(const HistogramSnapshot& other);
+    uint64_t count() const;
+    uint64_t sum() const{ return sum_; }
+    double mean() const;
+    //第q(0到1)分位数(最近秩，第ceil(q*n)个值)所在桶的上界(含)，没有数据时返回0
+    uint64_t percentile(double q) const;
+    const std::vector<uint64_t>& buckets() const{ return buckets_; }
+
+private:
+    friend class Histogram;
+    std::vector<uint64_t> buckets_;
+    uint64_t sum_ = 0;
+};
+
+//RAII计时：析构时把经过的纳秒数记到直方图里
+class ScopedTimer{
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer(){
+        histogram_.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+//RAII：作用域内把仪表加1(正在处理的请求数)
+class ScopedGauge{
+public:
+    explicit ScopedGauge(Gauge& gauge) : gauge_(gauge){ gauge_.add(); }
+    ~ScopedGauge(){ gauge_.sub(); }
+    ScopedGauge(const ScopedGauge&) = delete;
+    ScopedGauge& operator=(const ScopedGauge&) = delete;
+private:
+    Gauge& gauge_;
+};
+
+//所有指标按名字注册在这里，同名再注册返回同一个对象，类型不同抛std::logic_error
+//名字必须符合Prometheus的规则[a-zA-Z_:][a-zA-Z0-9_:]*，否则也抛std::logic_error
+//注册要加锁，指标对象的地址不会变，调用方应该保存引用而不是每次查找
+class Registry{
+public:
+    static Registry& get(){
+        //故意不释放：其他线程可能在静态对象析构之后还在记录，指标对象必须一直有效
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    Counter& counter(const std::string& name, const std::string& help = "");
+    Gauge& gauge(const std::string& name, const std::string& help = "");
+    Histogram& histogram(const std::string& name, const std::string& help = "");
+    //导出时才调用func取值，适合已有的状态(队列长度、对象池大小)；调用时不持有注册表的锁
+    void gaugeCallback(const std::string& name, const std::string& help, std::function<double()> func);
+
+    //Prometheus文本格式
+    std::string dump() const;
+    //先写临时文件(mkstemp)并fsync，再改名，读的一方(比如node_exporter的textfile收集器)不会读到一半的内容
+    void dumpToFile(const std::string& filename) const;
+    //连接本地的unix域socket，把文本写过去
+    void dumpToSocket(const std::string& path) const;
+
+private:
+    Registry() {}
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    enum Type{
+        COUNTER,
+        GAUGE,
+        GAUGE_CALLBACK,
+        HISTOGRAM
+    };
+
+    struct Family{
+        Type type;
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> callback;
+    };
+
+    Family& family(const std::string& name, const std::string& help, Type type, bool& created);
+    uint32_t allocCells(uint32_t n);
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+    uint32_t nextCell_ = 0;
+};
+
+} // namespace metrics
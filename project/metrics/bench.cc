@@ -0,0 +1,66 @@
+// g++ bench.cc Metrics.cc -std=c++17 -O2 -pthread -o bench
+#include "Metrics.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+using namespace metrics;
+
+const size_t kOps = 20000000;
+
+//threads个线程各执行kOps次f，返回平均每次的纳秒数(按单个线程的耗时算)
+template <typename F>
+double bench(int threads, F f){
+    std::atomic<bool> start{false};
+    std::vector<std::thread> workers;
+    std::vector<double> ns(threads);
+    for(int t = 0; t < threads; t++){
+        workers.emplace_back([&, t]{
+            while(!start.load(std::memory_order_acquire)){
+                std::this_thread::yield();
+            }
+            auto begin = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < kOps; i++){
+                f(i);
+            }
+            ns[t] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / kOps;
+        });
+    }
+    start.store(true, std::memory_order_release);
+    double total = 0;
+    for(int t = 0; t < threads; t++){
+        workers[t].join();
+        total += ns[t];
+    }
+    return total / threads;
+}
+
+int main(){
+    Registry& registry = Registry::get();
+    Counter& counter = registry.counter("bench_ops_total", "operations done by the benchmark");
+    Gauge& gauge = registry.gauge("bench_inflight", "in-flight operations");
+    Histogram& histogram = registry.histogram("bench_latency_ns", "synthetic latency in ns");
+    registry.gaugeCallback("bench_threads", "hardware threads", []{ return (double)std::thread::hardware_concurrency(); });
+
+    //对照：所有线程共用一个原子变量
+    alignas(64) std::atomic<uint64_t> shared{0};
+    std::mutex mutex;
+    uint64_t locked = 0;
+
+    for(int threads : {1, 2, 4}){
+        std::cout << "threads=" << threads << std::endl;
+        std::cout << "  Counter::inc        " << bench(threads, [&](size_t){ counter.inc(); }) << "ns" << std::endl;
+        std::cout << "  Histogram::record   " << bench(threads, [&](size_t i){ histogram.record(i & 0xfffff); }) << "ns" << std::endl;
+        std::cout << "  Gauge::add          " << bench(threads, [&](size_t){ gauge.add(); }) << "ns" << std::endl;
+        std::cout << "  atomic fetch_add    " << bench(threads, [&](size_t){ shared.fetch_add(1, std::memory_order_relaxed); }) << "ns" << std::endl;
+        std::cout << "  mutex ++            " << bench(threads, [&](size_t){ std::lock_guard<std::mutex> lock(mutex); locked++; }) << "ns" << std::endl;
+        std::cout << "  ScopedTimer (+clock)" << bench(threads, [&](size_t){ ScopedTimer timer(histogram); }) << "ns" << std::endl;
+    }
+
+    HistogramSnapshot snapshot = histogram.snapshot();
+    std::cout << "counter=" << counter.value() << " histogram count=" << snapshot.count()
+              << " p50=" << snapshot.percentile(0.5) << " p99=" << snapshot.percentile(0.99) << std::endl;
+
+    registry.dumpToFile("./metrics.prom");
+    std::cout << registry.dump().substr(0, 600) << "..." << std::endl;
+    return 0;
+}
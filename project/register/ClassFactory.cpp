@@ -43,89 +43,231 @@ void Object::set(const string & fieldName, const char * value)
 
 void Object::call(const string & methodName)
 {
-    ClassMethod * method = Singleton<ClassFactory>::instance()->get_class_method(m_className, methodName);
-    auto func = method->method();
-    typedef std::function<void(decltype(this))> class_method;
-    (*(class_method *)(func))(this);
+    call<void>(methodName);
 }
 
-void ClassFactory::register_class(const string & className, create_object method)
+//工厂在退出时由ShutdownRegistry析构，这时静态的ObjectHandle/ObjectBatch可能还没析构
+//所以池不直接delete，而是retire：没有存活对象的池立即释放，其余的等最后一个对象还回来
+//字段和方法在这之后不能再访问
+ClassFactory::~ClassFactory()
 {
-    m_classMap[className] = method;
+    const ClassTable * table = m_snapshot.load(std::memory_order_acquire);
+    const ClassTable & current = table != nullptr ? *table : m_building;
+    for (ObjectPool * pool : m_retiredPools)
+    {
+        pool->retire();
+    }
+    for (auto & item : current)
+    {
+        if (item.second.pool != nullptr)
+        {
+            item.second.pool->retire();
+        }
+        for (ClassField * field : item.second.fields)
+        {
+            delete field;
+        }
+        for (ClassMethod * method : item.second.methods)
+        {
+            delete method;
+        }
+    }
+    delete table;
+    for (const ClassTable * retired : m_retired)
+    {
+        delete retired;
+    }
+}
+
+template <typename R, typename F>
+R ClassFactory::lookup(const string & className, R notFound, F func)
+{
+    const ClassTable * table = m_snapshot.load(std::memory_order_acquire);
+    if (table != nullptr)
+    {
+        auto it = table->find(className);
+        return it == table->end() ? notFound : func(it->second);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    //等锁期间可能有人freeze了，m_building已经搬进快照被清空，要重新读一次快照
+    table = m_snapshot.load(std::memory_order_acquire);
+    const ClassTable & current = table != nullptr ? *table : m_building;
+    auto it = current.find(className);
+    return it == current.end() ? notFound : func(it->second);
+}
+
+template <typename F>
+void ClassFactory::modify(F func)
+{
+    const ClassTable * table = m_snapshot.load(std::memory_order_relaxed);
+    if (table == nullptr)
+    {
+        func(m_building);
+        return;
+    }
+    ClassTable * next = new ClassTable(*table);
+    func(*next);
+    m_snapshot.store(next, std::memory_order_release);
+    m_retired.push_back(table);
+}
+
+void ClassFactory::freeze()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_snapshot.load(std::memory_order_relaxed) != nullptr)
+    {
+        return;
+    }
+    m_snapshot.store(new ClassTable(std::move(m_building)), std::memory_order_release);
+    m_building.clear();
+}
+
+bool ClassFactory::frozen() const
+{
+    return m_snapshot.load(std::memory_order_acquire) != nullptr;
+}
+
+void ClassFactory::register_class(const string & className, create_object method,
+                                  place_object place, size_t size, size_t align)
+{
+    ObjectPool * pool = place != nullptr ? new ObjectPool(place, size, align) : nullptr;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    modify([&](ClassTable & table) {
+        ClassInfo & info = table[className];
+        info.creator = method;
+        //无锁的读者可能刚查到旧池，旧池上也可能还有对象，留到工厂析构时再释放
+        if (info.pool != nullptr)
+        {
+            m_retiredPools.push_back(info.pool);
+        }
+        info.pool = pool;
+    });
+}
+
+bool ClassFactory::has_class(const string & className)
+{
+    return lookup(className, false, [](const ClassInfo &) {
+        return true;
+    });
 }
 
 Object * ClassFactory::create_class(const string & className)
 {
-    auto it = m_classMap.find(className);
-    if (it == m_classMap.end())
+    create_object creator = lookup(className, (create_object)nullptr, [](const ClassInfo & info) {
+        return info.creator;
+    });
+    if (creator == nullptr)
     {
         return nullptr;
     }
-    return it->second();
+    return creator();
+}
+
+ObjectHandle ClassFactory::create_class_pooled(const string & className)
+{
+    ObjectPool * pool = lookup(className, (ObjectPool *)nullptr, [](const ClassInfo & info) {
+        return info.pool;
+    });
+    if (pool == nullptr)
+    {
+        return ObjectHandle();
+    }
+    return ObjectHandle(pool->create(), pool);
+}
+
+ObjectBatch ClassFactory::create_class_bulk(const string & className, size_t count)
+{
+    ObjectPool * pool = lookup(className, (ObjectPool *)nullptr, [](const ClassInfo & info) {
+        return info.pool;
+    });
+    if (pool == nullptr)
+    {
+        return ObjectBatch();
+    }
+    return pool->create_bulk(count);
 }
 
-void ClassFactory::register_class_field(const string & className, const string & fieldName, const string & fieldType, size_t offset)
+void ClassFactory::register_class_field(const string & className, const string & fieldName, const string & fieldType, size_t offset,
+                                        size_t size, ClassField::Kind kind)
 {
-    m_classFields[className].push_back(new ClassField(fieldName, fieldType, offset));
+    ClassField * field = new ClassField(fieldName, fieldType, offset, size, kind);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    modify([&](ClassTable & table) {
+        table[className].fields.push_back(field);
+    });
 }
 
 int ClassFactory::get_class_field_count(const string & className)
 {
-    return m_classFields[className].size();
+    return lookup(className, 0, [](const ClassInfo & info) {
+        return (int)info.fields.size();
+    });
 }
 
 ClassField * ClassFactory::get_class_field(const string & className, int pos)
 {
-    int size = m_classFields[className].size();
-    if (pos < 0 || pos >= size)
-    {
-        return nullptr;
-    }
-    return m_classFields[className][pos];
+    return lookup(className, (ClassField *)nullptr, [&](const ClassInfo & info) -> ClassField * {
+        int size = info.fields.size();
+        if (pos < 0 || pos >= size)
+        {
+            return nullptr;
+        }
+        return info.fields[pos];
+    });
 }
 
 ClassField * ClassFactory::get_class_field(const string & className, const string & fieldName)
 {
-    auto fields = m_classFields[className];
-    for (auto it = fields.begin(); it != fields.end(); it++)
-    {
-        if ((*it)->name() == fieldName)
+    return lookup(className, (ClassField *)nullptr, [&](const ClassInfo & info) -> ClassField * {
+        for (auto it = info.fields.begin(); it != info.fields.end(); it++)
         {
-            return *it;
+            if ((*it)->name() == fieldName)
+            {
+                return *it;
+            }
         }
-    }
-    return nullptr;
+        return nullptr;
+    });
 }
 
-void ClassFactory::register_class_method(const string & className, const string &methodName, uintptr_t method)
+void ClassFactory::register_class_method(const string & className, ClassMethod * method)
 {
-    m_classMethods[className].push_back(new ClassMethod(methodName, method));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    modify([&](ClassTable & table) {
+        table[className].methods.push_back(method);
+    });
 }
 
 int ClassFactory::get_class_method_count(const string & className)
 {
-    return m_classMethods[className].size();
+    return lookup(className, 0, [](const ClassInfo & info) {
+        return (int)info.methods.size();
+    });
 }
 
 ClassMethod * ClassFactory::get_class_method(const string & className, int pos)
 {
-    int size = m_classMethods[className].size();
-    if (pos < 0 || pos >= size)
-    {
-        return nullptr;
-    }
-    return m_classMethods[className][pos];
+    return lookup(className, (ClassMethod *)nullptr, [&](const ClassInfo & info) -> ClassMethod * {
+        int size = info.methods.size();
+        if (pos < 0 || pos >= size)
+        {
+            return nullptr;
+        }
+        return info.methods[pos];
+    });
 }
 
 ClassMethod * ClassFactory::get_class_method(const string & className, const string & methodName)
 {
-    auto methods = m_classMethods[className];
-    for (auto it = methods.begin(); it != methods.end(); it++)
-    {
-        if ((*it)->name() == methodName)
+    return lookup(className, (ClassMethod *)nullptr, [&](const ClassInfo & info) -> ClassMethod * {
+        for (auto it = info.methods.begin(); it != info.methods.end(); it++)
         {
-            return *it;
+            if ((*it)->name() == methodName)
+            {
+                return *it;
+            }
         }
-    }
-    return nullptr;
+        return nullptr;
+    });
 }
\ No newline at end of file
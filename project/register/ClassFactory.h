@@ -5,13 +5,20 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
 using namespace std;
 
 #include "../dp&&ds/singleton/singleton_template.h"
 using namespace single;
+#include "../dp&&ds/small_vector/small_vector.h"
 
 #include "ClassField.h"
 #include "ClassMethod.h"
+#include "FieldHandle.h"
+#include "ObjectPool.h"
 
 namespace regist {
 //类继承Object，把field在object的offset注册到register中。
@@ -39,8 +46,18 @@ public:
     template <typename T>
     void set(const string & fieldName, const T & value);
     void set(const string & fieldName, const char * value);
+
+    template <typename T>
+    FieldHandle<T> get_field_handle(const string & fieldName);
     
     void call(const string & methodName);
+    // 调用任意签名的方法，R和实参类型(去掉引用/cv)必须和注册的方法一致，否则抛异常
+    // T&参数要传非const左值，T&&参数要传非const右值，否则也抛异常
+    template <typename R = void, typename... Args>
+    R call(const string & methodName, Args &&... args);
+
+    template <typename Sig>
+    MethodHandle<Sig> get_method_handle(const string & methodName);
     virtual void show() = 0;
 
 private:
@@ -49,36 +66,113 @@ private:
 
 typedef Object * (*create_object)(void);
 
+//线程安全：
+//启动阶段的注册和查询都在锁里进行
+//freeze()之后所有类信息发布成一份只读快照，查询只读一次原子指针，不加锁
+//freeze()之后再注册(比如插件晚加载)时，复制快照修改后重新发布(RCU)，
+//旧快照可能还有读者在用，先挂起来，ClassFactory析构时才释放
 class ClassFactory
 {
     friend class Singleton<ClassFactory>;
 public:
+    // 启动注册完成后调用，之后的查询走无锁路径
+    void freeze();
+    bool frozen() const;
+
     // reflect class
-    void register_class(const string & className, create_object method);
+    void register_class(const string & className, create_object method,
+                        place_object place = nullptr, size_t size = 0, size_t align = 0);
+    // 注册过类、字段或方法中的任意一种
+    bool has_class(const string & className);
     Object * create_class(const string & className);
+    // 从类的对象池里创建，handle析构时内存还给池
+    ObjectHandle create_class_pooled(const string & className);
+    // 在一块连续内存上构造count个对象
+    ObjectBatch create_class_bulk(const string & className, size_t count);
 
     // reflect class field
-    void register_class_field(const string & className, const string & fieldName, const string & fieldType, size_t offset);
+    void register_class_field(const string & className, const string & fieldName, const string & fieldType, size_t offset,
+                              size_t size = 0, ClassField::Kind kind = ClassField::OTHER);
     int get_class_field_count(const string & className);
     ClassField * get_class_field(const string & className, int pos);
     ClassField * get_class_field(const string & className, const string & fieldName);
 
+    // 预解析字段，返回的handle可以反复使用，不再查找字段名
+    template <typename T>
+    FieldHandle<T> get_field_handle(const string & className, const string & fieldName);
+
     // reflect class method
-    void register_class_method(const string & className, const string &methodName, uintptr_t method);
+    void register_class_method(const string & className, ClassMethod * method);
     int get_class_method_count(const string & className);
     ClassMethod * get_class_method(const string & className, int pos);
     ClassMethod * get_class_method(const string & className, const string & methodName);
 
+    // 预解析方法，Sig必须和注册的签名完全一致，否则返回无效的handle
+    template <typename Sig>
+    MethodHandle<Sig> get_method_handle(const string & className, const string & methodName);
+
 private:
-    ClassFactory() {}
-    ~ClassFactory() {}
+    ClassFactory() : m_snapshot(nullptr) {}
+    ~ClassFactory();
+
+    struct ClassInfo
+    {
+        create_object creator = nullptr;
+        ObjectPool * pool = nullptr;
+        // 大多数类的字段和方法都不多，直接放在ClassInfo里，查找时不用再跳一次堆内存
+        vec::SmallVector<ClassField *, 8> fields;
+        vec::SmallVector<ClassMethod *, 4> methods;
+    };
+    typedef std::map<string, ClassInfo> ClassTable;
+
+    template <typename R, typename... Args>
+    static MethodHandle<R(Args...)> get_method_handle_impl(R (*)(Args...), ClassMethod * method);
+
+    // 查到className时返回func(info)，否则返回notFound
+    template <typename R, typename F>
+    R lookup(const string & className, R notFound, F func);
+    // 在锁里调用，修改当前的类信息
+    template <typename F>
+    void modify(F func);
 
 private:
-    std::map<string, create_object> m_classMap;
-    std::map<string, std::vector<ClassField *> > m_classFields;
-    std::map<string, std::vector<ClassMethod *> > m_classMethods;
+    std::mutex m_mutex;
+    ClassTable m_building;                      // freeze之前的类信息，受m_mutex保护
+    std::atomic<const ClassTable *> m_snapshot; // freeze之后发布的只读快照
+    std::vector<const ClassTable *> m_retired;  // 被替换下来的快照
+    std::vector<ObjectPool *> m_retiredPools;   // 重新注册时被替换下来的对象池
 };
 
+template <typename T>
+FieldHandle<T> ClassFactory::get_field_handle(const string & className, const string & fieldName)
+{
+    ClassField * field = get_class_field(className, fieldName);
+    if (field == nullptr)
+    {
+        return FieldHandle<T>();
+    }
+    // debug模式下校验T和注册时的fieldType是否一致
+    assert(field_type_name<T>::match(field->type()) && "field type mismatch");
+    return FieldHandle<T>(field->offset());
+}
+
+template <typename Sig>
+MethodHandle<Sig> ClassFactory::get_method_handle(const string & className, const string & methodName)
+{
+    ClassMethod * method = get_class_method(className, methodName);
+    return get_method_handle_impl((Sig *)nullptr, method);
+}
+
+template <typename R, typename... Args>
+MethodHandle<R(Args...)> ClassFactory::get_method_handle_impl(R (*)(Args...), ClassMethod * method)
+{
+    if (method == nullptr || method->signature() != method_signature<R, Args...>::tag())
+    {
+        return MethodHandle<R(Args...)>();
+    }
+    return MethodHandle<R(Args...)>((typename MethodHandle<R(Args...)>::direct_type)method->direct());
+}
+
 template <typename T>
 void Object::get(const string & fieldName, T & value)
 {
@@ -95,4 +189,35 @@ void Object::set(const string & fieldName, const T & value)
     *((T *)((unsigned char *)(this) + offset)) = value;
 }
 
+template <typename T>
+FieldHandle<T> Object::get_field_handle(const string & fieldName)
+{
+    return Singleton<ClassFactory>::instance()->get_field_handle<T>(m_className, fieldName);
+}
+
+template <typename R, typename... Args>
+R Object::call(const string & methodName, Args &&... args)
+{
+    ClassMethod * method = Singleton<ClassFactory>::instance()->get_class_method(m_className, methodName);
+    if (method == nullptr)
+    {
+        throw std::logic_error("method not found: " + m_className + "::" + methodName);
+    }
+    if (method->call_signature() != method_signature<R, std::decay_t<Args>...>::tag())
+    {
+        throw std::logic_error("method signature mismatch: " + m_className + "::" + methodName);
+    }
+    if (!method->accepts(arg_modes<Args...>()))
+    {
+        throw std::logic_error("method argument const/value category mismatch: " + m_className + "::" + methodName);
+    }
+    return invoke_packed<R>(method, this, std::forward<Args>(args)...);
+}
+
+template <typename Sig>
+MethodHandle<Sig> Object::get_method_handle(const string & methodName)
+{
+    return Singleton<ClassFactory>::instance()->get_method_handle<Sig>(m_className, methodName);
+}
+
 } // namespace regist
\ No newline at end of file
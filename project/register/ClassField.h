@@ -1,14 +1,28 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 using namespace std;
 
 namespace regist{
 class ClassField
 {
 public:
-    ClassField() : name_(""), type_(""), offset_(0) {}
-    ClassField(const string & name, const string & type, size_t offset) : name_(name), type_(type), offset_(offset) {}
+    //字段的存储类别，序列化时据此决定读写方式
+    enum Kind
+    {
+        BOOL = 0,
+        INT,        //有符号整数
+        UINT,       //无符号整数
+        FLOAT,      //float/double
+        STRING,     //std::string
+        POD,        //其他可以直接memcpy的类型
+        OTHER       //不支持按字节读写
+    };
+
+    ClassField() : name_(""), type_(""), offset_(0), size_(0), kind_(OTHER) {}
+    ClassField(const string & name, const string & type, size_t offset, size_t size = 0, Kind kind = OTHER)
+        : name_(name), type_(type), offset_(offset), size_(size), kind_(kind) {}
     ~ClassField() {}
 
     const string & name()
@@ -26,10 +40,57 @@ public:
         return offset_;
     }
 
+    size_t size()
+    {
+        return size_;
+    }
+
+    Kind kind()
+    {
+        return kind_;
+    }
+
+    //能否按原始字节整体拷贝
+    bool trivial()
+    {
+        return kind_ != STRING && kind_ != OTHER;
+    }
+
 private:
     string name_;
     string type_;
     size_t offset_;
+    size_t size_;
+    Kind kind_;
 };
 
+template <typename T>
+ClassField::Kind field_kind()
+{
+    if constexpr (std::is_same<T, bool>::value)
+    {
+        return ClassField::BOOL;
+    }
+    else if constexpr (std::is_integral<T>::value)
+    {
+        return std::is_signed<T>::value ? ClassField::INT : ClassField::UINT;
+    }
+    else if constexpr (std::is_floating_point<T>::value)
+    {
+        return ClassField::FLOAT;
+    }
+    else if constexpr (std::is_same<T, string>::value)
+    {
+        return ClassField::STRING;
+    }
+    else if constexpr (std::is_trivially_copyable<T>::value)
+    {
+        return ClassField::POD;
+    }
+    else
+    {
+        return ClassField::OTHER;
+    }
+}
+
 } // namespace regist
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+#include "ClassFactory.h"
+
+namespace regist {
+//编译期反射元信息
+//REGISTER_CLASS_FIELD需要在运行期通过静态对象注册到ClassFactory的map里
+//这里改为用成员指针组成的tuple描述字段，全部在编译期确定：
+//没有启动开销，不用构造任何对象，遍历字段也可以完全内联
+
+//字段偏移用offsetof在编译期算出，不需要对象
+//派生自Object的类有虚函数，不是standard-layout，offsetof对它们是"有条件支持"的：
+//GCC/Clang在没有虚基类时给出正确的结果，只是会报-Winvalid-offsetof，所以在lambda里关掉这个警告
+//(_Pragma不能直接出现在表达式中间)
+#define REGIST_FIELD_OFFSET(className, fieldName)                           \
+    ([]() constexpr -> size_t {                                             \
+        _Pragma("GCC diagnostic push")                                      \
+        _Pragma("GCC diagnostic ignored \"-Winvalid-offsetof\"")            \
+        return offsetof(className, fieldName);                              \
+        _Pragma("GCC diagnostic pop")                                       \
+    }())
+
+//单个字段的描述：名字、类型名、成员指针、偏移
+template <typename C, typename F>
+struct FieldMeta
+{
+    typedef C class_type;
+    typedef F field_type;
+
+    const char * name;
+    const char * type;
+    F C::* member;
+    size_t offset_;
+
+    constexpr FieldMeta(const char * n, const char * t, F C::* m, size_t o) : name(n), type(t), member(m), offset_(o) {}
+
+    F & get(C & obj) const
+    {
+        return obj.*member;
+    }
+
+    const F & get(const C & obj) const
+    {
+        return obj.*member;
+    }
+
+    constexpr size_t offset() const
+    {
+        return offset_;
+    }
+};
+
+//fieldType和成员的实际类型不一致时这里会编译失败
+template <typename C, typename F>
+constexpr FieldMeta<C, F> make_field_meta(const char * name, const char * type, F C::* member, size_t offset)
+{
+    return FieldMeta<C, F>(name, type, member, offset);
+}
+
+//没有特化的类表示没有编译期元信息
+template <typename C>
+struct ClassMeta;
+
+#define REFLECT_FIELD(className, fieldName, fieldType) \
+    regist::make_field_meta<className, fieldType>(#fieldName, #fieldType, &className::fieldName, \
+                                                  REGIST_FIELD_OFFSET(className, fieldName))
+
+//在全局作用域使用：
+//REGISTER_CLASS_META(A, REFLECT_FIELD(A, m_name, string), REFLECT_FIELD(A, m_age, int));
+#define REGISTER_CLASS_META(className, ...)                             \
+    namespace regist {                                                  \
+    template <>                                                         \
+    struct ClassMeta<className>                                         \
+    {                                                                   \
+        static constexpr const char * name = #className;                \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__);    \
+    };                                                                  \
+    }
+
+template <typename C>
+constexpr int get_class_field_count()
+{
+    return (int)std::tuple_size<std::decay_t<decltype(ClassMeta<C>::fields)>>::value;
+}
+
+template <typename C, int I>
+constexpr const auto & get_class_field()
+{
+    return std::get<I>(ClassMeta<C>::fields);
+}
+
+template <typename C, typename Func, size_t... I>
+void for_each_field_impl(Func && func, std::index_sequence<I...>)
+{
+    (func(std::get<I>(ClassMeta<C>::fields)), ...);
+}
+
+//依次把每个FieldMeta交给func，展开后没有循环和查找
+template <typename C, typename Func>
+void for_each_field(Func && func)
+{
+    for_each_field_impl<C>(std::forward<Func>(func), std::make_index_sequence<get_class_field_count<C>()>());
+}
+
+constexpr bool meta_name_equal(const char * a, const char * b)
+{
+    while (*a != '\0' && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+template <typename C, size_t... I>
+constexpr int get_class_field_index_impl(const char * fieldName, std::index_sequence<I...>)
+{
+    int index = -1;
+    ((index < 0 && meta_name_equal(std::get<I>(ClassMeta<C>::fields).name, fieldName) ? (index = (int)I) : 0), ...);
+    return index;
+}
+
+//字段名转下标，参数是字面量时在编译期完成，找不到返回-1
+template <typename C>
+constexpr int get_class_field_index(const char * fieldName)
+{
+    return get_class_field_index_impl<C>(fieldName, std::make_index_sequence<get_class_field_count<C>()>());
+}
+
+template <typename C, typename T, size_t... I>
+constexpr size_t get_field_offset_impl(const char * fieldName, std::index_sequence<I...>)
+{
+    size_t offset = FieldHandle<T>::npos;
+    ((offset == FieldHandle<T>::npos &&
+              std::is_same<typename std::decay_t<decltype(std::get<I>(ClassMeta<C>::fields))>::field_type, T>::value &&
+              meta_name_equal(std::get<I>(ClassMeta<C>::fields).name, fieldName)
+          ? (offset = std::get<I>(ClassMeta<C>::fields).offset())
+          : 0),
+     ...);
+    return offset;
+}
+
+//和ClassFactory::get_field_handle对应，按成员的实际类型匹配，而不是比较类型名字符串
+//查找在编译期完成：constexpr auto handle = get_field_handle<A, int>("m_age");
+//名字或类型不对时返回无效的handle，可以直接static_assert(handle.valid())
+template <typename C, typename T>
+constexpr FieldHandle<T> get_field_handle(const char * fieldName)
+{
+    return FieldHandle<T>(get_field_offset_impl<C, T>(fieldName, std::make_index_sequence<get_class_field_count<C>()>()));
+}
+
+//需要按字符串类名查询时，把编译期元信息一次性灌进ClassFactory
+//由调用方决定时机，不依赖静态对象的初始化顺序
+//可以重复调用，也可以和REGISTER_CLASS_FIELD混用：已经注册过的字段名跳过，字段下标不会变
+template <typename C>
+void register_class_meta()
+{
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    for_each_field<C>([&](const auto & field) {
+        typedef typename std::decay_t<decltype(field)>::field_type field_type;
+        if (factory->get_class_field(ClassMeta<C>::name, field.name) != nullptr)
+        {
+            return;
+        }
+        factory->register_class_field(ClassMeta<C>::name, field.name, field.type, field.offset(),
+                                      sizeof(field_type), field_kind<field_type>());
+    });
+}
+
+} // namespace regist
@@ -1,15 +1,168 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <type_traits>
 using namespace std;
 
 namespace regist {
 
+class Object;
+
+//方法签名的唯一标识，同一个签名在整个程序里地址相同
+template <typename R, typename... Args>
+struct method_signature
+{
+    static const void * tag()
+    {
+        static const char id = 0;
+        return &id;
+    }
+};
+
+//参数对实参的要求，每个参数占2位：1要求非const左值(T&)，2要求非const右值(T&&)，0只读(按值、const T&)
+template <typename A>
+constexpr uint64_t param_mode()
+{
+    return std::is_const<std::remove_reference_t<A>>::value ? 0
+         : std::is_lvalue_reference<A>::value               ? 1
+         : std::is_rvalue_reference<A>::value               ? 2
+                                                            : 0;
+}
+
+//Object::call的实参能满足的要求：非const左值是1，非const右值(包括数组退化出来的指针)是2，const是0
+template <typename A>
+constexpr uint64_t arg_mode()
+{
+    return std::is_array<std::remove_reference_t<A>>::value ? 2
+         : std::is_const<std::remove_reference_t<A>>::value ? 0
+         : std::is_lvalue_reference<A>::value               ? 1
+                                                            : 2;
+}
+
+template <typename... Args>
+constexpr uint64_t param_modes()
+{
+    static_assert(sizeof...(Args) <= 32, "too many method parameters");
+    uint64_t modes = 0;
+    int i = 0;
+    ((modes |= param_mode<Args>() << (2 * i++)), ...);
+    return modes;
+}
+
+template <typename... Args>
+constexpr uint64_t arg_modes()
+{
+    uint64_t modes = 0;
+    int i = 0;
+    ((modes |= arg_mode<Args>() << (2 * i++)), ...);
+    return modes;
+}
+
+//拆出成员函数指针的类、返回值和参数
+template <typename M>
+struct method_traits;
+
+template <typename C, typename R, typename... Args>
+struct method_traits<R (C::*)(Args...)>
+{
+    typedef C class_type;
+    typedef R return_type;
+    typedef R (*direct_type)(Object *, Args...);
+    typedef method_signature<R, Args...> signature;
+    typedef method_signature<R, std::decay_t<Args>...> call_signature;
+    static constexpr uint64_t modes = param_modes<Args...>();
+};
+
+template <typename C, typename R, typename... Args>
+struct method_traits<R (C::*)(Args...) const> : method_traits<R (C::*)(Args...)>
+{
+};
+
+template <typename C, typename R, typename... Args>
+struct method_traits<R (C::*)(Args...) noexcept> : method_traits<R (C::*)(Args...)>
+{
+};
+
+template <typename C, typename R, typename... Args>
+struct method_traits<R (C::*)(Args...) const noexcept> : method_traits<R (C::*)(Args...)>
+{
+};
+
+//只读的参数按const引用取实参(按值的参数从这里拷贝)，T&和T&&的参数按原样取
+template <typename A>
+using method_arg_ref = typename std::conditional<param_mode<A>() == 0 && !std::is_rvalue_reference<A>::value,
+                                                 const std::remove_reference_t<A> &, A>::type;
+
+template <typename A>
+method_arg_ref<A> unpack_arg(const void * address)
+{
+    typedef std::remove_reference_t<A> T;
+    if constexpr (param_mode<A>() == 0)
+    {
+        return static_cast<method_arg_ref<A>>(*static_cast<const T *>(address));
+    }
+    else
+    {
+        //Object::call已经按arg_modes检查过，这里的实参不是const
+        return static_cast<method_arg_ref<A>>(*const_cast<T *>(static_cast<const T *>(address)));
+    }
+}
+
+//为每个注册的方法生成的跳板函数，M是编译期常量，成员函数调用可以被内联
+template <auto M, typename Sig = decltype(M)>
+struct method_invoker;
+
+template <auto M, typename C, typename R, typename... Args>
+struct method_invoker<M, R (C::*)(Args...)>
+{
+    //MethodHandle调用，参数类型和注册的完全一致
+    static R direct(Object * obj, Args... args)
+    {
+        return (static_cast<C *>(obj)->*M)(std::forward<Args>(args)...);
+    }
+
+    //Object::call调用，参数以地址数组传入
+    static R packed(Object * obj, const void ** args)
+    {
+        return packed_impl(obj, args, std::index_sequence_for<Args...>());
+    }
+
+    template <size_t... I>
+    static R packed_impl(Object * obj, const void ** args, std::index_sequence<I...>)
+    {
+        return (static_cast<C *>(obj)->*M)(unpack_arg<Args>(args[I])...);
+    }
+};
+
+template <auto M, typename C, typename R, typename... Args>
+struct method_invoker<M, R (C::*)(Args...) const> : method_invoker<M, R (C::*)(Args...)>
+{
+};
+
+template <auto M, typename C, typename R, typename... Args>
+struct method_invoker<M, R (C::*)(Args...) noexcept> : method_invoker<M, R (C::*)(Args...)>
+{
+};
+
+template <auto M, typename C, typename R, typename... Args>
+struct method_invoker<M, R (C::*)(Args...) const noexcept> : method_invoker<M, R (C::*)(Args...)>
+{
+};
+
 class ClassMethod
 {
 public:
-    ClassMethod() : name_(""), method_(0) {}
-    ClassMethod(const string & name, uintptr_t method) : name_(name), method_(method) {}
+    typedef void (*invoker)();
+
+    ClassMethod() : name_(""), packed_(nullptr), direct_(nullptr), call_signature_(nullptr), signature_(nullptr), param_modes_(0) {}
+    ClassMethod(const string & name, invoker packed, invoker direct, const void * callSignature, const void * signature,
+                uint64_t paramModes)
+        : name_(name), packed_(packed), direct_(direct), call_signature_(callSignature), signature_(signature),
+          param_modes_(paramModes) {}
     ~ClassMethod() {}
 
     const string & name()
@@ -17,14 +170,129 @@ public:
         return name_;
     }
 
-    uintptr_t method()
+    //R (*)(Object *, const void **)
+    invoker packed()
+    {
+        return packed_;
+    }
+
+    //R (*)(Object *, Args...)
+    invoker direct()
+    {
+        return direct_;
+    }
+
+    //返回值和去掉引用/cv后的参数类型，Object::call用它检查实参
+    const void * call_signature()
+    {
+        return call_signature_;
+    }
+
+    //注册时的完整签名，MethodHandle用它检查
+    const void * signature()
     {
-        return method_;
+        return signature_;
+    }
+
+    //每个参数对实参const/左右值的要求，见param_mode
+    uint64_t param_modes()
+    {
+        return param_modes_;
+    }
+
+    //实参的arg_modes能不能传给这个方法：T&要非const左值，T&&要非const右值
+    bool accepts(uint64_t argModes)
+    {
+        return (param_modes_ & ~argModes) == 0;
     }
 
 private:
     string name_;
-    uintptr_t method_;
+    invoker packed_;
+    invoker direct_;
+    const void * call_signature_;
+    const void * signature_;
+    uint64_t param_modes_;
+};
+
+template <auto M>
+ClassMethod * make_class_method(const string & name)
+{
+    typedef method_traits<decltype(M)> traits;
+    typedef method_invoker<M> invoker;
+    return new ClassMethod(name, (ClassMethod::invoker)&invoker::packed, (ClassMethod::invoker)&invoker::direct,
+                           traits::call_signature::tag(), traits::signature::tag(), traits::modes);
+}
+
+//Object::call的实参，数组(比如字符串字面量)先退化成指针，和注册时的参数类型对齐
+template <typename A, bool = std::is_array<std::remove_reference_t<A>>::value>
+struct method_arg
+{
+    explicit method_arg(A & arg) : address_(std::addressof(arg)) {}
+    const void * address()
+    {
+        return address_;
+    }
+    const void * address_;
+};
+
+template <typename A>
+struct method_arg<A, true>
+{
+    explicit method_arg(A & arg) : decayed_(arg) {}
+    const void * address()
+    {
+        return &decayed_;
+    }
+    std::decay_t<A> decayed_;
+};
+
+template <typename R, typename Tuple, size_t... I>
+R invoke_packed_impl(ClassMethod * method, Object * obj, Tuple & args, std::index_sequence<I...>)
+{
+    const void * argv[sizeof...(I) + 1] = {std::get<I>(args).address()...};
+    typedef R (*packed_type)(Object *, const void **);
+    return ((packed_type)method->packed())(obj, argv);
+}
+
+//调用方需要先检查过call_signature和accepts
+template <typename R, typename... Args>
+R invoke_packed(ClassMethod * method, Object * obj, Args &&... args)
+{
+    std::tuple<method_arg<Args>...> holders{method_arg<Args>(args)...};
+    return invoke_packed_impl<R>(method, obj, holders, std::index_sequence_for<Args...>());
+}
+
+//预先解析好的方法，调用只有一次到跳板函数的间接调用
+template <typename Sig>
+class MethodHandle;
+
+template <typename R, typename... Args>
+class MethodHandle<R(Args...)>
+{
+public:
+    typedef R (*direct_type)(Object *, Args...);
+
+    MethodHandle() : func_(nullptr) {}
+    explicit MethodHandle(direct_type func) : func_(func) {}
+
+    bool valid() const
+    {
+        return func_ != nullptr;
+    }
+
+    explicit operator bool() const
+    {
+        return valid();
+    }
+
+    R operator()(Object * obj, Args... args) const
+    {
+        return func_(obj, std::forward<Args>(args)...);
+    }
+
+private:
+    direct_type func_;
 };
 
-} // namespace regist
\ No newline at end of file
+} // namespace regist
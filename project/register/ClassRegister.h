@@ -1,28 +1,31 @@
 #pragma once
 
 #include "ClassFactory.h"
+#include "ClassMeta.h"
+#include <new>
 
 namespace regist {
 
 class ClassRegister
 {
 public:
-    ClassRegister(const string & className, create_object method)
+    ClassRegister(const string & className, create_object method, place_object place, size_t size, size_t align)
     {
         // register class
-        Singleton<ClassFactory>::instance()->register_class(className, method);
+        Singleton<ClassFactory>::instance()->register_class(className, method, place, size, align);
     }
 
-    ClassRegister(const string & className, const string & fieldName, const string & fieldType, uintptr_t offset)
+    ClassRegister(const string & className, const string & fieldName, const string & fieldType, uintptr_t offset,
+                  size_t size, ClassField::Kind kind)
     {
         // register class field
-        Singleton<ClassFactory>::instance()->register_class_field(className, fieldName, fieldType, offset);
+        Singleton<ClassFactory>::instance()->register_class_field(className, fieldName, fieldType, offset, size, kind);
     }
 
-    ClassRegister(const string & className, const string & methodName, uintptr_t method)
+    ClassRegister(const string & className, ClassMethod * method)
     {
         // register class method
-        Singleton<ClassFactory>::instance()->register_class_method(className, methodName, method);
+        Singleton<ClassFactory>::instance()->register_class_method(className, method);
     }
 };
 
@@ -33,16 +36,25 @@ public:
         Object * obj = new className();                                 \
         obj->set_class_name(#className);                                \
         return obj;                                                     \
-    }                                                                  	\
-    ClassRegister classRegister##className(#className, createObject##className)
+    }                                                                   \
+    Object * placeObject##className(void * p)                           \
+    {                                                                   \
+        Object * obj = new (p) className();                             \
+        obj->set_class_name(#className);                                \
+        return obj;                                                     \
+    }                                                                   \
+    ClassRegister classRegister##className(#className, createObject##className, \
+                                           placeObject##className, sizeof(className), alignof(className))
 
+//偏移用offsetof在编译期算出，不构造className对象；fieldType和成员类型不一致时编译失败
 #define REGISTER_CLASS_FIELD(className, fieldName, fieldType) \
-    className className##fieldName; \
-    ClassRegister classRegister##className##fieldName(#className, #fieldName, #fieldType, (size_t)(&(className##fieldName.fieldName)) - (size_t)(&className##fieldName))
+    static_assert(std::is_same<decltype(className::fieldName), fieldType>::value, #className "::" #fieldName " is not " #fieldType); \
+    ClassRegister classRegister##className##fieldName(#className, #fieldName, #fieldType, REGIST_FIELD_OFFSET(className, fieldName), \
+                                                      sizeof(fieldType), regist::field_kind<fieldType>())
 
+//方法可以是任意签名，注册的是以成员函数指针为模板参数生成的跳板函数
 #define REGISTER_CLASS_METHOD(className, methodName) \
-    std::function<void(className *)> className##methodName##method = &className::methodName; \
-    ClassRegister classRegister##className##methodName(#className, #methodName, (uintptr_t)&(className##methodName##method))
+    ClassRegister classRegister##className##methodName(#className, regist::make_class_method<&className::methodName>(#methodName))
 
 
 } // namespace regist
\ No newline at end of file
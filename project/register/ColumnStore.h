@@ -0,0 +1,421 @@
+#pragma once
+
+#include <cstring>
+#include <new>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+#include <vector>
+#include <stdexcept>
+using namespace std;
+
+#include "ClassFactory.h"
+
+namespace regist {
+
+//一列数据的只读/可写视图
+template <typename F>
+class ColumnView
+{
+public:
+    ColumnView(F * data, size_t size) : data_(data), size_(size) {}
+
+    F * data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    F & operator[](size_t pos) const
+    {
+        return data_[pos];
+    }
+
+    F * begin() const
+    {
+        return data_;
+    }
+
+    F * end() const
+    {
+        return data_ + size_;
+    }
+
+private:
+    F * data_;
+    size_t size_;
+};
+
+//按列(SoA)存放一组注册类的对象
+//每个注册字段一列：可直接拷贝的字段是一块64字节对齐的连续内存，string字段是vector<string>
+//扫描某个字段只会访问这一列的cache line，循环可以被编译器向量化
+//T必须继承Object，字段信息来自ClassFactory，只支持可拷贝字段和string字段
+//className必须是T注册时的类名(构造时用create_class创建一个对象检查类型)，否则抛异常
+template <typename T>
+class ReflectedColumnStore
+{
+public:
+    explicit ReflectedColumnStore(const string & className);
+    ~ReflectedColumnStore();
+    ReflectedColumnStore(const ReflectedColumnStore &) = delete;
+    ReflectedColumnStore & operator=(const ReflectedColumnStore &) = delete;
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    size_t field_count() const
+    {
+        return m_columns.size();
+    }
+
+    void reserve(size_t capacity);
+    void clear();
+
+    //把对象的各字段分散写到各列
+    void push_back(const T & obj);
+    //把第row行的各列收集回对象
+    void load(size_t row, T & obj) const;
+
+    //取一列，F必须和注册的字段类型一致
+    template <typename F>
+    ColumnView<F> column(const string & fieldName);
+    template <typename F>
+    ColumnView<const F> column(const string & fieldName) const;
+
+    //在一列上遍历
+    template <typename F, typename Func>
+    void for_each(const string & fieldName, Func func) const;
+    //返回满足pred的行号
+    template <typename F, typename Pred>
+    std::vector<size_t> filter(const string & fieldName, Pred pred) const;
+    //在一列上做归约，分路累加后再合并：identity必须是op的单位元，op要满足结合律和交换律
+    template <typename F, typename Acc, typename Op>
+    Acc reduce(const string & fieldName, Acc identity, Op op) const;
+    template <typename F, typename Acc = F>
+    Acc sum(const string & fieldName) const;
+
+private:
+    struct Column
+    {
+        ClassField * field;
+        unsigned char * data;           //可拷贝字段
+        std::vector<string> * strings;  //string字段
+    };
+
+    static const size_t kAlign = 64;
+
+    const Column & find_column(const string & fieldName) const;
+    void grow(size_t capacity);
+    void release();
+
+private:
+    string m_className;
+    std::vector<Column> m_columns;
+    size_t m_size;
+    size_t m_capacity;
+};
+
+template <typename T>
+ReflectedColumnStore<T>::ReflectedColumnStore(const string & className)
+    : m_className(className), m_size(0), m_capacity(0)
+{
+    static_assert(std::is_base_of<Object, T>::value, "T must derive from Object");
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    //字段的offset是按注册的类算的，类名对应的类必须正好是T(不能是T的派生类或其他类)
+    Object * sample = factory->create_class(className);
+    bool match = sample != nullptr && typeid(*sample) == typeid(T);
+    delete sample;
+    if (!match)
+    {
+        throw std::logic_error("class " + className + " is not registered as " + typeid(T).name());
+    }
+
+    try
+    {
+        int count = factory->get_class_field_count(className);
+        for (int i = 0; i < count; i++)
+        {
+            ClassField * field = factory->get_class_field(className, i);
+            if (field->kind() == ClassField::OTHER)
+            {
+                throw std::logic_error("field can not be stored by column: " + className + "::" + field->name());
+            }
+            Column column;
+            column.field = field;
+            column.data = nullptr;
+            column.strings = nullptr;
+            m_columns.push_back(column);
+            if (field->kind() == ClassField::STRING)
+            {
+                m_columns.back().strings = new std::vector<string>();
+            }
+        }
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+}
+
+template <typename T>
+ReflectedColumnStore<T>::~ReflectedColumnStore()
+{
+    release();
+}
+
+template <typename T>
+void ReflectedColumnStore<T>::release()
+{
+    for (Column & column : m_columns)
+    {
+        if (column.data != nullptr)
+        {
+            ::operator delete(column.data, std::align_val_t(kAlign));
+        }
+        delete column.strings;
+    }
+    m_columns.clear();
+}
+
+//先分配好所有列的新内存再替换，中途分配失败时释放已经分配的，原来的数据不受影响
+template <typename T>
+void ReflectedColumnStore<T>::grow(size_t capacity)
+{
+    std::vector<unsigned char *> fresh(m_columns.size(), nullptr);
+    try
+    {
+        for (size_t i = 0; i < m_columns.size(); i++)
+        {
+            Column & column = m_columns[i];
+            if (column.strings != nullptr)
+            {
+                column.strings->reserve(capacity);
+                continue;
+            }
+            fresh[i] = (unsigned char *)::operator new(capacity * column.field->size(), std::align_val_t(kAlign));
+        }
+    }
+    catch (...)
+    {
+        for (unsigned char * data : fresh)
+        {
+            if (data != nullptr)
+            {
+                ::operator delete(data, std::align_val_t(kAlign));
+            }
+        }
+        throw;
+    }
+
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        Column & column = m_columns[i];
+        if (column.strings != nullptr)
+        {
+            continue;
+        }
+        if (column.data != nullptr)
+        {
+            memcpy(fresh[i], column.data, m_size * column.field->size());
+            ::operator delete(column.data, std::align_val_t(kAlign));
+        }
+        column.data = fresh[i];
+    }
+    m_capacity = capacity;
+}
+
+template <typename T>
+void ReflectedColumnStore<T>::reserve(size_t capacity)
+{
+    if (capacity > m_capacity)
+    {
+        grow(capacity);
+    }
+}
+
+template <typename T>
+void ReflectedColumnStore<T>::clear()
+{
+    for (Column & column : m_columns)
+    {
+        if (column.strings != nullptr)
+        {
+            column.strings->clear();
+        }
+    }
+    m_size = 0;
+}
+
+template <typename T>
+void ReflectedColumnStore<T>::push_back(const T & obj)
+{
+    if (m_size == m_capacity)
+    {
+        grow(m_capacity == 0 ? 16 : m_capacity * 2);
+    }
+    const unsigned char * base = (const unsigned char *)static_cast<const Object *>(&obj);
+    for (Column & column : m_columns)
+    {
+        const unsigned char * p = base + column.field->offset();
+        if (column.strings != nullptr)
+        {
+            column.strings->push_back(*(const string *)p);
+        }
+        else
+        {
+            size_t size = column.field->size();
+            memcpy(column.data + m_size * size, p, size);
+        }
+    }
+    m_size++;
+}
+
+template <typename T>
+void ReflectedColumnStore<T>::load(size_t row, T & obj) const
+{
+    unsigned char * base = (unsigned char *)static_cast<Object *>(&obj);
+    for (const Column & column : m_columns)
+    {
+        unsigned char * p = base + column.field->offset();
+        if (column.strings != nullptr)
+        {
+            *(string *)p = (*column.strings)[row];
+        }
+        else
+        {
+            size_t size = column.field->size();
+            memcpy(p, column.data + row * size, size);
+        }
+    }
+}
+
+template <typename T>
+const typename ReflectedColumnStore<T>::Column & ReflectedColumnStore<T>::find_column(const string & fieldName) const
+{
+    for (const Column & column : m_columns)
+    {
+        if (column.field->name() == fieldName)
+        {
+            return column;
+        }
+    }
+    throw std::logic_error("field not found: " + m_className + "::" + fieldName);
+}
+
+template <typename T>
+template <typename F>
+ColumnView<const F> ReflectedColumnStore<T>::column(const string & fieldName) const
+{
+    static_assert(std::is_same<F, string>::value || std::is_trivially_copyable<F>::value,
+                  "column type must be string or trivially copyable");
+    const Column & column = find_column(fieldName);
+    // debug模式下校验F和注册时的fieldType是否一致
+    assert(field_type_name<F>::match(column.field->type()) && "field type mismatch");
+    if constexpr (std::is_same<F, string>::value)
+    {
+        if (column.strings == nullptr)
+        {
+            throw std::logic_error("field type mismatch: " + m_className + "::" + fieldName);
+        }
+        return ColumnView<const F>(column.strings->data(), m_size);
+    }
+    else
+    {
+        //release模式下assert不生效，至少保证类别和大小一致，int不会被当成float、有符号不会被当成无符号
+        if (column.strings != nullptr || field_kind<F>() != column.field->kind() || sizeof(F) != column.field->size())
+        {
+            throw std::logic_error("field type mismatch: " + m_className + "::" + fieldName);
+        }
+        return ColumnView<const F>((const F *)column.data, m_size);
+    }
+}
+
+template <typename T>
+template <typename F>
+ColumnView<F> ReflectedColumnStore<T>::column(const string & fieldName)
+{
+    ColumnView<const F> view = static_cast<const ReflectedColumnStore *>(this)->template column<F>(fieldName);
+    return ColumnView<F>(const_cast<F *>(view.data()), view.size());
+}
+
+template <typename T>
+template <typename F, typename Func>
+void ReflectedColumnStore<T>::for_each(const string & fieldName, Func func) const
+{
+    ColumnView<const F> view = column<F>(fieldName);
+    const F * data = view.data();
+    size_t size = view.size();
+    for (size_t i = 0; i < size; i++)
+    {
+        func(i, data[i]);
+    }
+}
+
+template <typename T>
+template <typename F, typename Pred>
+std::vector<size_t> ReflectedColumnStore<T>::filter(const string & fieldName, Pred pred) const
+{
+    ColumnView<const F> view = column<F>(fieldName);
+    const F * data = view.data();
+    size_t size = view.size();
+    //无分支的写法：每行都写一次行号，满足条件才前移
+    std::vector<size_t> rows(size + 1);
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        rows[count] = i;
+        count += pred(data[i]) ? 1 : 0;
+    }
+    rows.resize(count);
+    return rows;
+}
+
+template <typename T>
+template <typename F, typename Acc, typename Op>
+Acc ReflectedColumnStore<T>::reduce(const string & fieldName, Acc identity, Op op) const
+{
+    ColumnView<const F> view = column<F>(fieldName);
+    const F * data = view.data();
+    size_t size = view.size();
+    //分8路独立累加，打破循环间的依赖，浮点数也能向量化
+    const size_t kLanes = 8;
+    Acc lanes[kLanes];
+    for (size_t k = 0; k < kLanes; k++)
+    {
+        lanes[k] = identity;
+    }
+    size_t i = 0;
+    for (; i + kLanes <= size; i += kLanes)
+    {
+        for (size_t k = 0; k < kLanes; k++)
+        {
+            lanes[k] = op(lanes[k], data[i + k]);
+        }
+    }
+    Acc acc = identity;
+    for (size_t k = 0; k < kLanes; k++)
+    {
+        acc = op(acc, lanes[k]);
+    }
+    for (; i < size; i++)
+    {
+        acc = op(acc, data[i]);
+    }
+    return acc;
+}
+
+template <typename T>
+template <typename F, typename Acc>
+Acc ReflectedColumnStore<T>::sum(const string & fieldName) const
+{
+    return reduce<F>(fieldName, Acc(), [](Acc a, Acc b) { return a + b; });
+}
+
+} // namespace regist
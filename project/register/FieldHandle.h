@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+using namespace std;
+
+namespace regist {
+
+class Object;
+
+//字段类型名检查：注册时fieldType只是宏里的字符串(#fieldType)
+//这里把常用的C++类型和它们可能的写法对应起来，用于debug模式下校验
+//未特化的类型(比如用户自定义结构体)不做检查
+template <typename T>
+struct field_type_name
+{
+    static bool match(const string &)
+    {
+        return true;
+    }
+};
+
+#define REGIST_FIELD_TYPE_NAME(type, ...)                               \
+    template <>                                                         \
+    struct field_type_name<type>                                        \
+    {                                                                   \
+        static bool match(const string & name)                          \
+        {                                                               \
+            for (const char * alias : {__VA_ARGS__})                    \
+            {                                                           \
+                if (name == alias)                                      \
+                {                                                       \
+                    return true;                                        \
+                }                                                       \
+            }                                                           \
+            return false;                                               \
+        }                                                               \
+    }
+
+REGIST_FIELD_TYPE_NAME(bool, "bool");
+REGIST_FIELD_TYPE_NAME(char, "char");
+REGIST_FIELD_TYPE_NAME(signed char, "signed char", "int8_t");
+REGIST_FIELD_TYPE_NAME(unsigned char, "unsigned char", "uint8_t");
+REGIST_FIELD_TYPE_NAME(short, "short", "int16_t");
+REGIST_FIELD_TYPE_NAME(unsigned short, "unsigned short", "uint16_t");
+REGIST_FIELD_TYPE_NAME(int, "int", "int32_t");
+REGIST_FIELD_TYPE_NAME(unsigned int, "unsigned", "unsigned int", "uint32_t");
+REGIST_FIELD_TYPE_NAME(long, "long", "int64_t");
+REGIST_FIELD_TYPE_NAME(unsigned long, "unsigned long", "uint64_t", "size_t");
+REGIST_FIELD_TYPE_NAME(long long, "long long", "int64_t");
+REGIST_FIELD_TYPE_NAME(unsigned long long, "unsigned long long", "uint64_t");
+REGIST_FIELD_TYPE_NAME(float, "float");
+REGIST_FIELD_TYPE_NAME(double, "double");
+REGIST_FIELD_TYPE_NAME(string, "string", "std::string");
+
+//预先解析好的字段访问器
+//通过ClassFactory::get_field_handle<T>()拿到，只解析一次字段名
+//之后每次访问就是this指针加offset再取值，没有任何字符串操作
+template <typename T>
+class FieldHandle
+{
+public:
+    static const size_t npos = (size_t)-1;
+
+    constexpr FieldHandle() : offset_(npos) {}
+    constexpr explicit FieldHandle(size_t offset) : offset_(offset) {}
+
+    constexpr bool valid() const
+    {
+        return offset_ != npos;
+    }
+
+    constexpr explicit operator bool() const
+    {
+        return valid();
+    }
+
+    constexpr size_t offset() const
+    {
+        return offset_;
+    }
+
+    T & get(Object * obj) const
+    {
+        return *((T *)((unsigned char *)(obj) + offset_));
+    }
+
+    const T & get(const Object * obj) const
+    {
+        return *((const T *)((const unsigned char *)(obj) + offset_));
+    }
+
+    void set(Object * obj, const T & value) const
+    {
+        get(obj) = value;
+    }
+
+private:
+    size_t offset_;
+};
+
+} // namespace regist
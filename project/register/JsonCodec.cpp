@@ -0,0 +1,585 @@
+#include "JsonCodec.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+using namespace regist;
+
+namespace {
+
+//就地解析器，cur_在buffer上向前移动
+class JsonParser
+{
+public:
+    JsonParser(char * data, size_t size) : begin_(data), cur_(data), end_(data + size) {}
+
+    void skip_ws()
+    {
+        while (cur_ < end_ && (*cur_ == ' ' || *cur_ == '\t' || *cur_ == '\n' || *cur_ == '\r'))
+        {
+            cur_++;
+        }
+    }
+
+    char peek()
+    {
+        skip_ws();
+        return cur_ < end_ ? *cur_ : '\0';
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c)
+        {
+            fail(string("expect '") + c + "'");
+        }
+        cur_++;
+    }
+
+    bool consume(char c)
+    {
+        if (peek() == c)
+        {
+            cur_++;
+            return true;
+        }
+        return false;
+    }
+
+    //值后面只能有空白
+    void expect_end()
+    {
+        skip_ws();
+        if (cur_ != end_)
+        {
+            fail("trailing characters after value");
+        }
+    }
+
+    bool consume_literal(const char * literal)
+    {
+        size_t size = strlen(literal);
+        skip_ws();
+        if ((size_t)(end_ - cur_) >= size && memcmp(cur_, literal, size) == 0)
+        {
+            cur_ += size;
+            return true;
+        }
+        return false;
+    }
+
+    //解析字符串，转义在原buffer里就地还原，返回[start, start + size)
+    void parse_string(char *& start, size_t & size)
+    {
+        expect('"');
+        start = cur_;
+        char * out = cur_;
+        while (true)
+        {
+            if (cur_ >= end_)
+            {
+                fail("unterminated string");
+            }
+            char c = *cur_++;
+            if (c == '"')
+            {
+                break;
+            }
+            if (c != '\\')
+            {
+                *out++ = c;
+                continue;
+            }
+            if (cur_ >= end_)
+            {
+                fail("unterminated string");
+            }
+            c = *cur_++;
+            switch (c)
+            {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u':
+            {
+                uint32_t code = parse_hex4();
+                if (code >= 0xD800 && code <= 0xDBFF)
+                {
+                    if (end_ - cur_ < 2 || cur_[0] != '\\' || cur_[1] != 'u')
+                    {
+                        fail("bad surrogate pair");
+                    }
+                    cur_ += 2;
+                    uint32_t low = parse_hex4();
+                    if (low < 0xDC00 || low > 0xDFFF)
+                    {
+                        fail("bad surrogate pair");
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if (code >= 0xDC00 && code <= 0xDFFF)
+                {
+                    fail("lone low surrogate");
+                }
+                //utf-8编码不会比\uXXXX长，可以安全地写回
+                out = put_utf8(out, code);
+                break;
+            }
+            default:
+                fail("bad escape");
+            }
+        }
+        size = out - start;
+    }
+
+    //数字只确定范围，交给from_chars转换
+    void parse_number(const char *& start, const char *& stop)
+    {
+        skip_ws();
+        start = cur_;
+        while (cur_ < end_ && (isdigit((unsigned char)*cur_) || *cur_ == '-' || *cur_ == '+' || *cur_ == '.' || *cur_ == 'e' || *cur_ == 'E'))
+        {
+            cur_++;
+        }
+        stop = cur_;
+        if (start == stop)
+        {
+            fail("expect number");
+        }
+    }
+
+    //跳过一个不关心的值，嵌套深度有上限，输入来自外部时不能让递归把栈打爆
+    void skip_value(int depth = 0)
+    {
+        char c = peek();
+        if (c == '"')
+        {
+            char * start;
+            size_t size;
+            parse_string(start, size);
+        }
+        else if (c == '{' || c == '[')
+        {
+            if (depth >= kMaxDepth)
+            {
+                fail("too deep");
+            }
+            char close = (c == '{') ? '}' : ']';
+            cur_++;
+            if (consume(close))
+            {
+                return;
+            }
+            do
+            {
+                if (close == '}')
+                {
+                    char * start;
+                    size_t size;
+                    parse_string(start, size);
+                    expect(':');
+                }
+                skip_value(depth + 1);
+            } while (consume(','));
+            expect(close);
+        }
+        else if (!consume_literal("true") && !consume_literal("false") && !consume_literal("null"))
+        {
+            const char * start;
+            const char * stop;
+            parse_number(start, stop);
+        }
+    }
+
+    [[noreturn]] void fail(const string & what)
+    {
+        throw std::logic_error("json: " + what + " at " + to_string(cur_ - begin_));
+    }
+
+private:
+    static const int kMaxDepth = 256;
+
+    uint32_t parse_hex4()
+    {
+        if (end_ - cur_ < 4)
+        {
+            fail("bad unicode escape");
+        }
+        uint32_t code = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char c = *cur_++;
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else fail("bad unicode escape");
+        }
+        return code;
+    }
+
+    static char * put_utf8(char * out, uint32_t code)
+    {
+        if (code < 0x80)
+        {
+            *out++ = (char)code;
+        }
+        else if (code < 0x800)
+        {
+            *out++ = (char)(0xC0 | (code >> 6));
+            *out++ = (char)(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            *out++ = (char)(0xE0 | (code >> 12));
+            *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+            *out++ = (char)(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            *out++ = (char)(0xF0 | (code >> 18));
+            *out++ = (char)(0x80 | ((code >> 12) & 0x3F));
+            *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+            *out++ = (char)(0x80 | (code & 0x3F));
+        }
+        return out;
+    }
+
+private:
+    char * begin_;
+    char * cur_;
+    char * end_;
+};
+
+//JSON没有NaN/Infinity，输出null(解码时null不修改字段)
+template <typename T>
+void put_number(string & out, T value)
+{
+    if constexpr (std::is_floating_point<T>::value)
+    {
+        if (!std::isfinite(value))
+        {
+            out.append("null");
+            return;
+        }
+    }
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr - buf);
+}
+
+void put_string(string & out, const string & value)
+{
+    static const char * hex = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                out.append("\\u00");
+                out.push_back(hex[(c >> 4) & 0xF]);
+                out.push_back(hex[c & 0xF]);
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+//按字段大小读写整数
+template <typename T>
+T load_int(const unsigned char * p, size_t size)
+{
+    typedef typename std::conditional<std::is_signed<T>::value, int8_t, uint8_t>::type i8;
+    typedef typename std::conditional<std::is_signed<T>::value, int16_t, uint16_t>::type i16;
+    typedef typename std::conditional<std::is_signed<T>::value, int32_t, uint32_t>::type i32;
+    switch (size)
+    {
+    case 1: return *(const i8 *)p;
+    case 2: return *(const i16 *)p;
+    case 4: return *(const i32 *)p;
+    default: return *(const T *)p;
+    }
+}
+
+template <typename T>
+bool store_int(unsigned char * p, size_t size, T value)
+{
+    typedef typename std::conditional<std::is_signed<T>::value, int8_t, uint8_t>::type i8;
+    typedef typename std::conditional<std::is_signed<T>::value, int16_t, uint16_t>::type i16;
+    typedef typename std::conditional<std::is_signed<T>::value, int32_t, uint32_t>::type i32;
+    switch (size)
+    {
+    case 1: *(i8 *)p = (i8)value; return (T)*(i8 *)p == value;
+    case 2: *(i16 *)p = (i16)value; return (T)*(i16 *)p == value;
+    case 4: *(i32 *)p = (i32)value; return (T)*(i32 *)p == value;
+    default: *(T *)p = value; return true;
+    }
+}
+
+} // namespace
+
+uint32_t JsonCodec::hash_key(const char * key, size_t size, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+const JsonCodec::KeyTable & JsonCodec::get_table(const string & className)
+{
+    auto it = m_tables.find(className);
+    if (it != m_tables.end())
+    {
+        return it->second;
+    }
+
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    KeyTable table;
+    int count = factory->get_class_field_count(className);
+    for (int i = 0; i < count; i++)
+    {
+        ClassField * field = factory->get_class_field(className, i);
+        //同名字段的key永远会冲突，找seed的循环不会结束
+        for (ClassField * other : table.fields)
+        {
+            if (other->name() == field->name())
+            {
+                throw std::logic_error("duplicate field: " + className + "::" + field->name());
+            }
+        }
+        table.fields.push_back(field);
+    }
+
+    //从2倍字段数开始找一个没有冲突的seed，找不到就把表扩大一倍
+    size_t size = 1;
+    while (size < table.fields.size() * 2)
+    {
+        size <<= 1;
+    }
+    while (true)
+    {
+        bool found = false;
+        for (uint32_t seed = 0; seed < 256 && !found; seed++)
+        {
+            table.slots.assign(size, -1);
+            found = true;
+            for (size_t i = 0; i < table.fields.size(); i++)
+            {
+                const string & name = table.fields[i]->name();
+                uint32_t slot = hash_key(name.data(), name.size(), seed) & (size - 1);
+                if (table.slots[slot] >= 0)
+                {
+                    found = false;
+                    break;
+                }
+                table.slots[slot] = (int)i;
+            }
+            table.seed = seed;
+        }
+        if (found)
+        {
+            break;
+        }
+        size <<= 1;
+    }
+    table.mask = (uint32_t)(size - 1);
+    return m_tables.emplace(className, std::move(table)).first->second;
+}
+
+void JsonCodec::encode(Object * obj, string & out)
+{
+    const KeyTable & table = get_table(obj->get_class_name());
+    const unsigned char * base = (const unsigned char *)obj;
+
+    out.push_back('{');
+    for (size_t i = 0; i < table.fields.size(); i++)
+    {
+        ClassField * field = table.fields[i];
+        if (i > 0)
+        {
+            out.push_back(',');
+        }
+        put_string(out, field->name());
+        out.push_back(':');
+
+        const unsigned char * p = base + field->offset();
+        switch (field->kind())
+        {
+        case ClassField::BOOL:
+            out.append(*(const bool *)p ? "true" : "false");
+            break;
+        case ClassField::INT:
+            put_number(out, load_int<int64_t>(p, field->size()));
+            break;
+        case ClassField::UINT:
+            put_number(out, load_int<uint64_t>(p, field->size()));
+            break;
+        case ClassField::FLOAT:
+            if (field->size() == sizeof(float))
+            {
+                put_number(out, *(const float *)p);
+            }
+            else
+            {
+                put_number(out, *(const double *)p);
+            }
+            break;
+        case ClassField::STRING:
+            put_string(out, *(const string *)p);
+            break;
+        default:
+            throw std::logic_error("field can not be encoded: " + obj->get_class_name() + "::" + field->name());
+        }
+    }
+    out.push_back('}');
+}
+
+void JsonCodec::decode(char * json, size_t size, Object * obj)
+{
+    const KeyTable & table = get_table(obj->get_class_name());
+    unsigned char * base = (unsigned char *)obj;
+    JsonParser parser(json, size);
+
+    parser.expect('{');
+    if (parser.consume('}'))
+    {
+        parser.expect_end();
+        return;
+    }
+    do
+    {
+        char * key;
+        size_t keySize;
+        parser.parse_string(key, keySize);
+        parser.expect(':');
+
+        ClassField * field = nullptr;
+        int index = table.slots[hash_key(key, keySize, table.seed) & table.mask];
+        if (index >= 0)
+        {
+            const string & name = table.fields[index]->name();
+            if (name.size() == keySize && memcmp(name.data(), key, keySize) == 0)
+            {
+                field = table.fields[index];
+            }
+        }
+        if (field == nullptr)
+        {
+            parser.skip_value();
+            continue;
+        }
+        if (parser.consume_literal("null"))
+        {
+            continue;
+        }
+
+        unsigned char * p = base + field->offset();
+        switch (field->kind())
+        {
+        case ClassField::BOOL:
+            if (parser.consume_literal("true"))
+            {
+                *(bool *)p = true;
+            }
+            else if (parser.consume_literal("false"))
+            {
+                *(bool *)p = false;
+            }
+            else
+            {
+                parser.fail("expect bool for " + field->name());
+            }
+            break;
+        case ClassField::INT:
+        case ClassField::UINT:
+        case ClassField::FLOAT:
+        {
+            const char * start;
+            const char * stop;
+            parser.parse_number(start, stop);
+            bool ok;
+            if (field->kind() == ClassField::INT)
+            {
+                int64_t value = 0;
+                ok = std::from_chars(start, stop, value).ptr == stop && store_int(p, field->size(), value);
+            }
+            else if (field->kind() == ClassField::UINT)
+            {
+                uint64_t value = 0;
+                ok = std::from_chars(start, stop, value).ptr == stop && store_int(p, field->size(), value);
+            }
+            else if (field->size() == sizeof(float))
+            {
+                ok = std::from_chars(start, stop, *(float *)p).ptr == stop;
+            }
+            else
+            {
+                ok = std::from_chars(start, stop, *(double *)p).ptr == stop;
+            }
+            if (!ok)
+            {
+                parser.fail("bad number for " + field->name());
+            }
+            break;
+        }
+        case ClassField::STRING:
+        {
+            char * start;
+            size_t len;
+            parser.parse_string(start, len);
+            ((string *)p)->assign(start, len);
+            break;
+        }
+        default:
+            parser.fail("field can not be decoded: " + field->name());
+        }
+    } while (parser.consume(','));
+    parser.expect('}');
+    parser.expect_end();
+}
+
+void JsonCodec::decode(string & json, Object * obj)
+{
+    decode(&json[0], json.size(), obj);
+}
+
+Object * JsonCodec::decode(const string & className, char * json, size_t size)
+{
+    Object * obj = Singleton<ClassFactory>::instance()->create_class(className);
+    if (obj == nullptr)
+    {
+        throw std::logic_error("class not registered: " + className);
+    }
+    try
+    {
+        decode(json, size, obj);
+    }
+    catch (...)
+    {
+        delete obj;
+        throw;
+    }
+    return obj;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdexcept>
+using namespace std;
+
+#include "ClassFactory.h"
+
+namespace regist {
+
+//基于ClassFactory字段信息的JSON编解码
+//编码：按注册顺序输出 {"field":value,...}
+//解码：就地解析，不建DOM。字符串的转义直接在输入buffer里还原，
+//  key通过每个类的完美hash表找到字段，值直接写到对象的offset上
+//  未注册的key会被跳过，null不修改字段；对象后面除了空白不能有别的内容
+//  浮点字段是NaN/Infinity时编码成null
+//支持bool/整数/浮点/string字段，其他类型的字段会抛异常
+//hash表在第一次用到某个类时生成并缓存，同一个codec不要在多个线程间共享
+class JsonCodec
+{
+public:
+    void encode(Object * obj, string & out);
+
+    //json会被改写，调用后内容不再是原来的json
+    void decode(char * json, size_t size, Object * obj);
+    void decode(string & json, Object * obj);
+    //用create_class创建对象后解码
+    Object * decode(const string & className, char * json, size_t size);
+
+private:
+    //字段名的完美hash：size是2的幂，每个字段落在不同的槽里
+    struct KeyTable
+    {
+        uint32_t seed;
+        uint32_t mask;
+        std::vector<int> slots;     //槽 -> fields下标，-1表示空
+        std::vector<ClassField *> fields;
+    };
+
+    const KeyTable & get_table(const string & className);
+    static uint32_t hash_key(const char * key, size_t size, uint32_t seed);
+
+private:
+    std::map<string, KeyTable> m_tables;
+};
+
+} // namespace regist
@@ -0,0 +1,193 @@
+#include "ObjectDiff.h"
+#include <cstring>
+using namespace regist;
+
+//serializer按类缓存计划，不能跨线程共享，每个线程一份
+static uint64_t schema_hash(const string & className)
+{
+    thread_local BinarySerializer serializer;
+    return serializer.schema_hash(className);
+}
+
+bool ObjectDelta::empty() const
+{
+    return changed_count() == 0;
+}
+
+size_t ObjectDelta::changed_count() const
+{
+    size_t count = 0;
+    for (uint64_t word : m_bitmap)
+    {
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+void ObjectDelta::encode(string & out) const
+{
+    ByteWriter writer(out);
+    writer.write_string(m_className);
+    writer.write_u64(m_schemaHash);
+    writer.write_varint(m_fieldCount);
+    for (uint32_t i = 0; i < m_fieldCount; i += 8)
+    {
+        unsigned char byte = (unsigned char)(m_bitmap[i >> 6] >> (i & 63));
+        writer.write(&byte, 1);
+    }
+    writer.write(m_values.data(), m_values.size());
+}
+
+ObjectDelta ObjectDelta::decode(const char * data, size_t size, size_t * consumed)
+{
+    ObjectDelta delta;
+    ByteReader reader(data, size);
+    reader.read_string(delta.m_className);
+
+    //apply_delta会把非string字段按字节写进对象，和diff_objects一样拒绝不能按字节拷贝的字段
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    int count = factory->get_class_field_count(delta.m_className);
+    for (int i = 0; i < count; i++)
+    {
+        ClassField * field = factory->get_class_field(delta.m_className, i);
+        if (field->kind() != ClassField::STRING && !field->trivial())
+        {
+            throw std::logic_error("field can not be diffed: " + delta.m_className + "::" + field->name());
+        }
+    }
+    //只比较字段数的话，字段数相同但布局不同的两端会互相写错字节
+    delta.m_schemaHash = reader.read_u64();
+    if (delta.m_schemaHash != schema_hash(delta.m_className))
+    {
+        throw std::logic_error("delta schema mismatch: " + delta.m_className);
+    }
+    if (reader.read_varint() != (uint64_t)count)
+    {
+        throw std::logic_error("delta field count mismatch: " + delta.m_className);
+    }
+    delta.m_fieldCount = count;
+    delta.m_bitmap.assign((count + 63) / 64, 0);
+    for (int i = 0; i < count; i += 8)
+    {
+        unsigned char byte;
+        reader.read(&byte, 1);
+        delta.m_bitmap[i >> 6] |= (uint64_t)byte << (i & 63);
+    }
+    if (count % 64 != 0)
+    {
+        delta.m_bitmap.back() &= ((uint64_t)1 << (count % 64)) - 1;
+    }
+
+    //按bitmap把变化字段的值切出来，顺便检查长度
+    size_t start = reader.consumed();
+    for (int i = 0; i < count; i++)
+    {
+        if (!delta.changed(i))
+        {
+            continue;
+        }
+        ClassField * field = factory->get_class_field(delta.m_className, i);
+        if (field->kind() == ClassField::STRING)
+        {
+            string value;
+            reader.read_string(value);
+        }
+        else
+        {
+            string value(field->size(), '\0');
+            reader.read(&value[0], value.size());
+        }
+    }
+    delta.m_values.assign(data + start, reader.consumed() - start);
+
+    if (consumed != nullptr)
+    {
+        *consumed = reader.consumed();
+    }
+    return delta;
+}
+
+ObjectDelta regist::diff_objects(Object * from, Object * to)
+{
+    const string & className = from->get_class_name();
+    if (to->get_class_name() != className)
+    {
+        throw std::logic_error("diff between different classes: " + className + " and " + to->get_class_name());
+    }
+
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    int count = factory->get_class_field_count(className);
+
+    ObjectDelta delta;
+    delta.m_className = className;
+    delta.m_fieldCount = count;
+    delta.m_bitmap.assign((count + 63) / 64, 0);
+    ByteWriter writer(delta.m_values);
+
+    const unsigned char * a = (const unsigned char *)from;
+    const unsigned char * b = (const unsigned char *)to;
+    for (int i = 0; i < count; i++)
+    {
+        ClassField * field = factory->get_class_field(className, i);
+        size_t offset = field->offset();
+        if (field->kind() == ClassField::STRING)
+        {
+            const string & value = *(const string *)(b + offset);
+            if (*(const string *)(a + offset) == value)
+            {
+                continue;
+            }
+            writer.write_string(value);
+        }
+        else if (field->trivial())
+        {
+            if (memcmp(a + offset, b + offset, field->size()) == 0)
+            {
+                continue;
+            }
+            writer.write(b + offset, field->size());
+        }
+        else
+        {
+            throw std::logic_error("field can not be diffed: " + className + "::" + field->name());
+        }
+        delta.m_bitmap[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+    delta.m_schemaHash = schema_hash(className);
+    return delta;
+}
+
+void regist::apply_delta(Object * target, const ObjectDelta & delta)
+{
+    if (target->get_class_name() != delta.m_className)
+    {
+        throw std::logic_error("delta of " + delta.m_className + " applied to " + target->get_class_name());
+    }
+
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    ByteReader reader(delta.m_values.data(), delta.m_values.size());
+    unsigned char * base = (unsigned char *)target;
+    for (uint32_t i = 0; i < delta.m_fieldCount; i++)
+    {
+        if (!delta.changed(i))
+        {
+            continue;
+        }
+        ClassField * field = factory->get_class_field(delta.m_className, i);
+        if (field->kind() == ClassField::STRING)
+        {
+            reader.read_string(*(string *)(base + field->offset()));
+        }
+        else if (field->kind() == ClassField::BOOL)
+        {
+            //不是0/1的字节当bool读是未定义行为
+            unsigned char byte;
+            reader.read(&byte, 1);
+            *(bool *)(base + field->offset()) = byte != 0;
+        }
+        else
+        {
+            reader.read(base + field->offset(), field->size());
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "ClassFactory.h"
+#include "Serializer.h"
+
+namespace regist {
+
+//两个同类对象之间的差异
+//字段id就是注册顺序里的下标，bitmap标记哪些字段变了，values按id顺序存变了的字段的新值
+//编码格式：类名 | schema hash(8字节) | 字段数(varint) | bitmap((字段数+7)/8字节) | values
+//  values里可拷贝字段写原始字节，string字段写varint长度+内容
+//  schema hash和BinarySerializer::schema_hash一样，两端字段布局不同时decode抛异常
+class ObjectDelta
+{
+public:
+    ObjectDelta() : m_schemaHash(0), m_fieldCount(0) {}
+
+    const string & class_name() const
+    {
+        return m_className;
+    }
+
+    bool empty() const;
+    size_t changed_count() const;
+    bool changed(int fieldId) const
+    {
+        return (m_bitmap[fieldId >> 6] >> (fieldId & 63)) & 1;
+    }
+
+    void encode(string & out) const;
+    static ObjectDelta decode(const char * data, size_t size, size_t * consumed = nullptr);
+
+private:
+    friend ObjectDelta diff_objects(Object * from, Object * to);
+    friend void apply_delta(Object * target, const ObjectDelta & delta);
+
+    string m_className;
+    uint64_t m_schemaHash;
+    uint32_t m_fieldCount;
+    std::vector<uint64_t> m_bitmap;
+    string m_values;
+};
+
+//逐字段比较from和to：可拷贝字段用memcmp，string字段比较内容
+//返回的delta应用到和from一样的对象上就得到to
+ObjectDelta diff_objects(Object * from, Object * to);
+
+//把delta里变化的字段写到target上
+void apply_delta(Object * target, const ObjectDelta & delta);
+
+} // namespace regist
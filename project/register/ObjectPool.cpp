@@ -0,0 +1,249 @@
+#include "ObjectPool.h"
+#include "ClassFactory.h"
+#include <new>
+using namespace regist;
+
+ObjectHandle & ObjectHandle::operator=(ObjectHandle && other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        obj_ = other.obj_;
+        pool_ = other.pool_;
+        other.obj_ = nullptr;
+    }
+    return *this;
+}
+
+void ObjectHandle::reset()
+{
+    if (obj_ != nullptr)
+    {
+        pool_->destroy(obj_);
+        obj_ = nullptr;
+    }
+}
+
+ObjectBatch & ObjectBatch::operator=(ObjectBatch && other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        pool_ = other.pool_;
+        block_ = other.block_;
+        count_ = other.count_;
+        stride_ = other.stride_;
+        offset_ = other.offset_;
+        other.block_ = nullptr;
+        other.count_ = 0;
+    }
+    return *this;
+}
+
+void ObjectBatch::reset()
+{
+    if (block_ != nullptr)
+    {
+        pool_->destroy_bulk(block_, count_);
+        block_ = nullptr;
+        count_ = 0;
+    }
+}
+
+ObjectPool::ObjectPool(place_object place, size_t size, size_t align)
+    : m_place(place), m_align(align < sizeof(void *) ? sizeof(void *) : align), m_offset(0), m_live(0), m_retired(false),
+      m_freeSlots(nullptr)
+{
+    if (size < sizeof(FreeSlot))
+    {
+        size = sizeof(FreeSlot);
+    }
+    m_stride = (size + m_align - 1) / m_align * m_align;
+}
+
+ObjectPool::~ObjectPool()
+{
+    for (auto & block : m_allBlocks)
+    {
+        ::operator delete(block.first, std::align_val_t(m_align));
+    }
+}
+
+void ObjectPool::retire()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_retired = true;
+        if (m_live != 0)
+        {
+            return;
+        }
+    }
+    delete this;
+}
+
+void ObjectPool::record_offset(Object * obj, void * slot)
+{
+    //同一个类的偏移都一样，多个线程同时写也是同一个值
+    m_offset.store((unsigned char *)obj - (unsigned char *)slot, std::memory_order_relaxed);
+}
+
+bool ObjectPool::release_live()
+{
+    m_live--;
+    return m_retired && m_live == 0;
+}
+
+int ObjectPool::block_order(size_t count)
+{
+    int order = 0;
+    while (((size_t)1 << order) < count)
+    {
+        order++;
+    }
+    return order;
+}
+
+unsigned char * ObjectPool::allocate_block(int order)
+{
+    if (!m_freeBlocks[order].empty())
+    {
+        unsigned char * block = m_freeBlocks[order].back();
+        m_freeBlocks[order].pop_back();
+        return block;
+    }
+    unsigned char * block = (unsigned char *)::operator new(m_stride << order, std::align_val_t(m_align));
+    m_allBlocks.push_back(std::make_pair(block, order));
+    return block;
+}
+
+void ObjectPool::release_block(unsigned char * block, int order)
+{
+    m_freeBlocks[order].push_back(block);
+}
+
+Object * ObjectPool::create()
+{
+    void * slot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeSlots == nullptr)
+        {
+            unsigned char * block = allocate_block(kRefillOrder);
+            for (size_t i = 0; i < ((size_t)1 << kRefillOrder); i++)
+            {
+                FreeSlot * free = (FreeSlot *)(block + i * m_stride);
+                free->next = m_freeSlots;
+                m_freeSlots = free;
+            }
+        }
+        slot = m_freeSlots;
+        m_freeSlots = m_freeSlots->next;
+        m_live++;
+    }
+
+    try
+    {
+        Object * obj = m_place(slot);
+        record_offset(obj, slot);
+        return obj;
+    }
+    catch (...)
+    {
+        //和destroy一样，已经retire的池在最后一个对象还回来时释放
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            FreeSlot * free = (FreeSlot *)slot;
+            free->next = m_freeSlots;
+            m_freeSlots = free;
+            last = release_live();
+        }
+        if (last)
+        {
+            delete this;
+        }
+        throw;
+    }
+}
+
+void ObjectPool::destroy(Object * obj)
+{
+    unsigned char * slot = (unsigned char *)obj - m_offset.load(std::memory_order_relaxed);
+    obj->~Object();
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        FreeSlot * free = (FreeSlot *)slot;
+        free->next = m_freeSlots;
+        m_freeSlots = free;
+        last = release_live();
+    }
+    if (last)
+    {
+        delete this;
+    }
+}
+
+ObjectBatch ObjectPool::create_bulk(size_t count)
+{
+    if (count == 0)
+    {
+        return ObjectBatch();
+    }
+    int order = block_order(count);
+    unsigned char * block;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        block = allocate_block(order);
+        m_live++;
+    }
+
+    size_t built = 0;
+    try
+    {
+        for (; built < count; built++)
+        {
+            record_offset(m_place(block + built * m_stride), block + built * m_stride);
+        }
+    }
+    catch (...)
+    {
+        ptrdiff_t offset = m_offset.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < built; i++)
+        {
+            ((Object *)(block + i * m_stride + offset))->~Object();
+        }
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            release_block(block, order);
+            last = release_live();
+        }
+        if (last)
+        {
+            delete this;
+        }
+        throw;
+    }
+    return ObjectBatch(this, block, count, m_stride, m_offset.load(std::memory_order_relaxed));
+}
+
+void ObjectPool::destroy_bulk(unsigned char * block, size_t count)
+{
+    ptrdiff_t offset = m_offset.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++)
+    {
+        ((Object *)(block + i * m_stride + offset))->~Object();
+    }
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        release_block(block, block_order(count));
+        last = release_live();
+    }
+    if (last)
+    {
+        delete this;
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+namespace regist {
+
+class Object;
+class ObjectPool;
+
+//在给定内存上构造对象
+typedef Object * (*place_object)(void *);
+
+//独占一个池里的对象，析构时把内存还给池
+class ObjectHandle
+{
+public:
+    ObjectHandle() : obj_(nullptr), pool_(nullptr) {}
+    ObjectHandle(Object * obj, ObjectPool * pool) : obj_(obj), pool_(pool) {}
+    ObjectHandle(const ObjectHandle &) = delete;
+    ObjectHandle & operator=(const ObjectHandle &) = delete;
+    ObjectHandle(ObjectHandle && other) noexcept : obj_(other.obj_), pool_(other.pool_)
+    {
+        other.obj_ = nullptr;
+    }
+    ObjectHandle & operator=(ObjectHandle && other) noexcept;
+    ~ObjectHandle()
+    {
+        reset();
+    }
+
+    Object * get() const
+    {
+        return obj_;
+    }
+
+    Object * operator->() const
+    {
+        return obj_;
+    }
+
+    Object & operator*() const
+    {
+        return *obj_;
+    }
+
+    explicit operator bool() const
+    {
+        return obj_ != nullptr;
+    }
+
+    void reset();
+
+private:
+    Object * obj_;
+    ObjectPool * pool_;
+};
+
+//一段连续内存上构造的一批对象，析构时整体还给池
+class ObjectBatch
+{
+public:
+    ObjectBatch() : pool_(nullptr), block_(nullptr), count_(0), stride_(0), offset_(0) {}
+    ObjectBatch(ObjectPool * pool, unsigned char * block, size_t count, size_t stride, ptrdiff_t offset)
+        : pool_(pool), block_(block), count_(count), stride_(stride), offset_(offset) {}
+    ObjectBatch(const ObjectBatch &) = delete;
+    ObjectBatch & operator=(const ObjectBatch &) = delete;
+    ObjectBatch(ObjectBatch && other) noexcept
+        : pool_(other.pool_), block_(other.block_), count_(other.count_), stride_(other.stride_), offset_(other.offset_)
+    {
+        other.block_ = nullptr;
+        other.count_ = 0;
+    }
+    ObjectBatch & operator=(ObjectBatch && other) noexcept;
+    ~ObjectBatch()
+    {
+        reset();
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    //对象之间的间隔，等于对齐后的sizeof
+    size_t stride() const
+    {
+        return stride_;
+    }
+
+    Object * operator[](size_t pos) const
+    {
+        return (Object *)(block_ + pos * stride_ + offset_);
+    }
+
+    void reset();
+
+private:
+    ObjectPool * pool_;
+    unsigned char * block_;
+    size_t count_;
+    size_t stride_;
+    ptrdiff_t offset_; //Object基类在对象内的偏移
+};
+
+//一个注册类的对象池
+//单个对象从空闲链表里取，链表不够时一次补一整块
+//批量对象按2的幂大小分配连续内存块，释放后按大小缓存起来复用
+//内存只在池析构时还给系统
+//池由ClassFactory调用retire()释放：还有对象或批量对象没还回来时，等最后一个还回来再析构
+class ObjectPool
+{
+public:
+    ObjectPool(place_object place, size_t size, size_t align);
+
+    //不再从这个池创建对象，没有存活的对象时立即析构，否则由最后一次destroy/destroy_bulk析构
+    void retire();
+
+    Object * create();
+    void destroy(Object * obj);
+
+    ObjectBatch create_bulk(size_t count);
+    void destroy_bulk(unsigned char * block, size_t count);
+
+    size_t stride() const
+    {
+        return m_stride;
+    }
+
+private:
+    ~ObjectPool();
+
+    //Object基类相对对象起始地址的偏移，派生类有多个基类时不一定是0
+    void record_offset(Object * obj, void * slot);
+    //destroy/destroy_bulk之后调用，返回true时调用方要delete this
+    bool release_live();
+
+    //容量为2^order个对象的内存块
+    unsigned char * allocate_block(int order);
+    void release_block(unsigned char * block, int order);
+    static int block_order(size_t count);
+
+    struct FreeSlot
+    {
+        FreeSlot * next;
+    };
+
+private:
+    static const int kRefillOrder = 6; //空闲链表每次补64个
+
+    place_object m_place;
+    size_t m_align;
+    size_t m_stride;
+    std::atomic<ptrdiff_t> m_offset;
+
+    std::mutex m_mutex;
+    size_t m_live;  //存活的对象数加上批量对象数
+    bool m_retired;
+    FreeSlot * m_freeSlots;
+    std::vector<unsigned char *> m_freeBlocks[64];
+    std::vector<std::pair<unsigned char *, int> > m_allBlocks;
+};
+
+} // namespace regist
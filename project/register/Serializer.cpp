@@ -0,0 +1,154 @@
+#include "Serializer.h"
+#include <algorithm>
+using namespace regist;
+
+static uint64_t fnv1a(uint64_t hash, const void * data, size_t size)
+{
+    const unsigned char * p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+const BinarySerializer::Plan & BinarySerializer::get_plan(const string & className)
+{
+    auto it = m_plans.find(className);
+    if (it != m_plans.end())
+    {
+        return it->second;
+    }
+
+    //类名可能来自外部数据，没注册的类不生成计划，否则坏数据可以让m_plans无限增长
+    ClassFactory * factory = Singleton<ClassFactory>::instance();
+    if (!factory->has_class(className))
+    {
+        throw std::logic_error("class not registered: " + className);
+    }
+    int count = factory->get_class_field_count(className);
+    std::vector<ClassField *> fields;
+    for (int i = 0; i < count; i++)
+    {
+        fields.push_back(factory->get_class_field(className, i));
+    }
+    std::sort(fields.begin(), fields.end(), [](ClassField * a, ClassField * b) {
+        return a->offset() < b->offset();
+    });
+
+    Plan plan;
+    plan.hash = fnv1a(14695981039346656037ULL, className.data(), className.size());
+    for (ClassField * field : fields)
+    {
+        if (field->kind() == ClassField::OTHER)
+        {
+            throw std::logic_error("field can not be serialized: " + className + "::" + field->name());
+        }
+        plan.hash = fnv1a(plan.hash, field->name().data(), field->name().size() + 1);
+        plan.hash = fnv1a(plan.hash, field->type().data(), field->type().size() + 1);
+        size_t size = field->size();
+        plan.hash = fnv1a(plan.hash, &size, sizeof(size));
+        if (field->kind() == ClassField::BOOL)
+        {
+            plan.bools.push_back(field->offset());
+        }
+
+        if (!field->trivial())
+        {
+            plan.steps.push_back(Step{false, field->offset(), 0});
+            continue;
+        }
+        //和上一段紧挨着就合并，中间有空隙不能合并(空隙里可能是没注册的成员)
+        if (!plan.steps.empty())
+        {
+            Step & last = plan.steps.back();
+            if (last.copy && last.offset + last.size == field->offset())
+            {
+                last.size += size;
+                continue;
+            }
+        }
+        plan.steps.push_back(Step{true, field->offset(), size});
+    }
+    return m_plans.emplace(className, std::move(plan)).first->second;
+}
+
+uint64_t BinarySerializer::schema_hash(const string & className)
+{
+    return get_plan(className).hash;
+}
+
+void BinarySerializer::serialize(Object * obj, string & out)
+{
+    const string & className = obj->get_class_name();
+    const Plan & plan = get_plan(className);
+
+    ByteWriter writer(out);
+    writer.write_string(className);
+    writer.write_u64(plan.hash);
+
+    const unsigned char * base = (const unsigned char *)obj;
+    for (const Step & step : plan.steps)
+    {
+        if (step.copy)
+        {
+            writer.write(base + step.offset, step.size);
+        }
+        else
+        {
+            writer.write_string(*((const string *)(base + step.offset)));
+        }
+    }
+}
+
+Object * BinarySerializer::deserialize(const char * data, size_t size, size_t * consumed)
+{
+    ByteReader reader(data, size);
+    string className;
+    reader.read_string(className);
+    const Plan & plan = get_plan(className);
+    if (reader.read_u64() != plan.hash)
+    {
+        throw std::logic_error("schema mismatch: " + className);
+    }
+
+    Object * obj = Singleton<ClassFactory>::instance()->create_class(className);
+    if (obj == nullptr)
+    {
+        throw std::logic_error("class not registered: " + className);
+    }
+
+    unsigned char * base = (unsigned char *)obj;
+    try
+    {
+        for (const Step & step : plan.steps)
+        {
+            if (step.copy)
+            {
+                reader.read(base + step.offset, step.size);
+            }
+            else
+            {
+                reader.read_string(*((string *)(base + step.offset)));
+            }
+        }
+        //bool按字节整段拷贝进来，不是0/1的字节当bool读是未定义行为
+        for (size_t offset : plan.bools)
+        {
+            unsigned char byte = base[offset];
+            *((bool *)(base + offset)) = byte != 0;
+        }
+    }
+    catch (...)
+    {
+        delete obj;
+        throw;
+    }
+
+    if (consumed != nullptr)
+    {
+        *consumed = reader.consumed();
+    }
+    return obj;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdexcept>
+using namespace std;
+
+#include "ClassFactory.h"
+
+namespace regist {
+
+//字节流写入，追加到string末尾
+class ByteWriter
+{
+public:
+    explicit ByteWriter(string & out) : out_(out) {}
+
+    void write(const void * data, size_t size)
+    {
+        out_.append((const char *)data, size);
+    }
+
+    void write_u64(uint64_t value)
+    {
+        write(&value, sizeof(value));
+    }
+
+    //长度等小整数用varint，一般只占1个字节
+    void write_varint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out_.push_back((char)(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back((char)value);
+    }
+
+    void write_string(const string & value)
+    {
+        write_varint(value.size());
+        write(value.data(), value.size());
+    }
+
+private:
+    string & out_;
+};
+
+//字节流读取，越界时抛异常
+class ByteReader
+{
+public:
+    ByteReader(const char * data, size_t size) : begin_(data), cur_(data), end_(data + size) {}
+
+    void read(void * data, size_t size)
+    {
+        check(size);
+        memcpy(data, cur_, size);
+        cur_ += size;
+    }
+
+    uint64_t read_u64()
+    {
+        uint64_t value;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    uint64_t read_varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            check(1);
+            unsigned char byte = (unsigned char)*cur_++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw std::logic_error("bad varint");
+    }
+
+    void read_string(string & value)
+    {
+        size_t size = read_varint();
+        check(size);
+        value.assign(cur_, size);
+        cur_ += size;
+    }
+
+    size_t consumed() const
+    {
+        return cur_ - begin_;
+    }
+
+private:
+    void check(size_t size)
+    {
+        if ((size_t)(end_ - cur_) < size)
+        {
+            throw std::logic_error("unexpected end of data");
+        }
+    }
+
+private:
+    const char * begin_;
+    const char * cur_;
+    const char * end_;
+};
+
+//基于ClassFactory字段信息的二进制序列化
+//格式：类名(varint长度+字节) | schema hash(8字节) | 按offset顺序的字段
+//  可直接拷贝的字段按原始字节写，内存里首尾相接的一段合并成一次memcpy
+//  string字段写varint长度+内容
+//整数按本机字节序写，只用于同构机器之间
+//每个类的读写计划在第一次用到时生成并缓存(只缓存注册过的类)，同一个serializer不要在多个线程间共享
+class BinarySerializer
+{
+public:
+    //把obj追加写到out
+    void serialize(Object * obj, string & out);
+    //读出一个对象，对象由create_class创建，consumed返回用掉的字节数
+    Object * deserialize(const char * data, size_t size, size_t * consumed = nullptr);
+    //字段名、类型、大小按offset顺序算出的hash，字段有变化时读端会拒绝
+    uint64_t schema_hash(const string & className);
+
+private:
+    struct Step
+    {
+        bool copy;      //true: memcpy一段字节; false: string字段
+        size_t offset;
+        size_t size;
+    };
+
+    struct Plan
+    {
+        uint64_t hash;
+        std::vector<Step> steps;
+        std::vector<size_t> bools; //bool字段的offset，读回来的字节要规范成0/1
+    };
+
+    const Plan & get_plan(const string & className);
+
+private:
+    std::map<string, Plan> m_plans;
+};
+
+} // namespace regist
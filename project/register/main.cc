@@ -0,0 +1,393 @@
+// g++ main.cc ClassFactory.cpp ObjectPool.cpp Serializer.cpp JsonCodec.cpp ObjectDiff.cpp -std=c++17 -O2 -pthread -o main
+//反射各项功能的用法，每一项都检查结果，出错时assert失败
+#include "ClassRegister.h"
+#include "ColumnStore.h"
+#include "JsonCodec.h"
+#include "ObjectDiff.h"
+#include "Serializer.h"
+#include <cassert>
+using namespace regist;
+
+class Order : public Object
+{
+public:
+    void show()
+    {
+        cout << m_symbol << " " << m_qty << "@" << m_price << (m_active ? " active" : " closed") << endl;
+    }
+
+    double amount() const
+    {
+        return m_qty * m_price;
+    }
+
+    void rename(const string & symbol)
+    {
+        m_symbol = symbol;
+    }
+
+    //成交fill股，left返回剩余的数量
+    void fill(int count, int & left)
+    {
+        m_qty -= count;
+        left = m_qty;
+    }
+
+public:
+    string m_symbol;
+    int m_qty = 0;
+    double m_price = 0;
+    bool m_active = false;
+};
+
+REGISTER_CLASS(Order);
+REGISTER_CLASS_FIELD(Order, m_symbol, string);
+REGISTER_CLASS_FIELD(Order, m_qty, int);
+REGISTER_CLASS_FIELD(Order, m_price, double);
+REGISTER_CLASS_FIELD(Order, m_active, bool);
+REGISTER_CLASS_METHOD(Order, show);
+REGISTER_CLASS_METHOD(Order, amount);
+REGISTER_CLASS_METHOD(Order, rename);
+REGISTER_CLASS_METHOD(Order, fill);
+
+//编译期元信息，字段偏移在编译期就能拿到
+REGISTER_CLASS_META(Order, REFLECT_FIELD(Order, m_qty, int), REFLECT_FIELD(Order, m_price, double));
+
+//freeze之后才注册的类，比如插件晚加载
+class Quote : public Object
+{
+public:
+    void show()
+    {
+        cout << "quote " << m_bid << endl;
+    }
+
+public:
+    double m_bid = 0;
+};
+
+Object * createQuote()
+{
+    Object * obj = new Quote();
+    obj->set_class_name("Quote");
+    return obj;
+}
+
+Object * placeQuote(void * p)
+{
+    Object * obj = new (p) Quote();
+    obj->set_class_name("Quote");
+    return obj;
+}
+
+static ClassFactory * factory()
+{
+    return Singleton<ClassFactory>::instance();
+}
+
+static Order * new_order(const string & symbol, int qty, double price)
+{
+    Order * order = static_cast<Order *>(factory()->create_class("Order"));
+    order->m_symbol = symbol;
+    order->m_qty = qty;
+    order->m_price = price;
+    order->m_active = true;
+    return order;
+}
+
+void test_field()
+{
+    Order * order = new_order("AAPL", 100, 1.5);
+    int qty = 0;
+    order->get("m_qty", qty);
+    assert(qty == 100);
+    order->set("m_symbol", "MSFT");
+    assert(order->m_symbol == "MSFT");
+
+    //运行期按名字解析一次，之后直接按偏移访问
+    FieldHandle<double> price = order->get_field_handle<double>("m_price");
+    assert(price.valid() && price.get(order) == 1.5);
+    price.set(order, 2.5);
+    assert(order->m_price == 2.5);
+    assert(!order->get_field_handle<double>("m_none").valid());
+    delete order;
+    cout << "field ok" << endl;
+}
+
+void test_meta()
+{
+    Order * order = new_order("AAPL", 100, 1.5);
+    //编译期解析，和运行期注册的偏移一致
+    constexpr FieldHandle<int> qtyHandle = get_field_handle<Order, int>("m_qty");
+    static_assert(qtyHandle.valid(), "m_qty");
+    assert(qtyHandle.offset() == factory()->get_class_field("Order", "m_qty")->offset());
+    assert(qtyHandle.get(order) == 100);
+
+    //和REGISTER_CLASS_FIELD重复的字段不会再注册一遍
+    register_class_meta<Order>();
+    register_class_meta<Order>();
+    assert(factory()->get_class_field_count("Order") == 4);
+    delete order;
+    cout << "meta ok" << endl;
+}
+
+void test_method()
+{
+    Order * order = new_order("AAPL", 100, 1.5);
+    assert(order->call<double>("amount") == 150);
+    order->call<void>("rename", string("IBM"));
+    assert(order->m_symbol == "IBM");
+    int left = 0;
+    order->call<void>("fill", 30, left);
+    assert(left == 70);
+
+    //返回值或参数类型不一致、int&传了右值，都抛异常
+    bool thrown = false;
+    try
+    {
+        order->call<int>("amount");
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try
+    {
+        order->call<void>("fill", 1, 2);
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+
+    MethodHandle<double()> amount = order->get_method_handle<double()>("amount");
+    assert(amount.valid() && amount(order) == 105);
+    assert(!order->get_method_handle<int()>("amount").valid());
+    order->call("show");
+    delete order;
+    cout << "method ok" << endl;
+}
+
+void test_serializer()
+{
+    Order * order = new_order("AAPL", 100, 1.5);
+    BinarySerializer serializer;
+    string buf;
+    serializer.serialize(order, buf);
+    order->m_symbol = "GOOG";
+    serializer.serialize(order, buf);
+
+    //一个缓冲区里连续放两个对象
+    size_t used = 0;
+    Order * first = static_cast<Order *>(serializer.deserialize(buf.data(), buf.size(), &used));
+    Order * second = static_cast<Order *>(serializer.deserialize(buf.data() + used, buf.size() - used));
+    assert(first->m_symbol == "AAPL" && first->m_qty == 100 && first->m_price == 1.5 && first->m_active);
+    assert(second->m_symbol == "GOOG");
+
+    //数据被截断时抛异常
+    bool thrown = false;
+    try
+    {
+        serializer.deserialize(buf.data(), used - 1);
+    }
+    catch (const std::exception &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    delete order;
+    delete first;
+    delete second;
+    cout << "serializer ok" << endl;
+}
+
+void test_json()
+{
+    Order * order = new_order("A\"B\n", 100, 0.25);
+    JsonCodec codec;
+    string json;
+    codec.encode(order, json);
+    cout << json << endl;
+
+    //解码会原地改写输入，先拷贝一份
+    string copy = json;
+    Object * decoded = codec.decode("Order", &copy[0], copy.size());
+    string again;
+    codec.encode(decoded, again);
+    assert(again == json);
+    assert(static_cast<Order *>(decoded)->m_symbol == "A\"B\n");
+
+    //不认识的字段跳过，没有出现的字段保持原值
+    string patch = R"({"m_qty": 7, "unknown": [1, {"x": null}]})";
+    codec.decode(patch, decoded);
+    assert(static_cast<Order *>(decoded)->m_qty == 7 && static_cast<Order *>(decoded)->m_price == 0.25);
+
+    string bad = R"({"m_qty": 1} trailing)";
+    bool thrown = false;
+    try
+    {
+        codec.decode(bad, decoded);
+    }
+    catch (const std::exception &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+
+    //跳过的值嵌套太深时抛异常，不会递归到栈溢出
+    string deep = "{\"unknown\":" + string(100000, '[') + string(100000, ']') + "}";
+    thrown = false;
+    try
+    {
+        codec.decode(deep, decoded);
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    delete order;
+    delete decoded;
+    cout << "json ok" << endl;
+}
+
+void test_diff()
+{
+    Order * from = new_order("AAPL", 100, 1.5);
+    Order * to = new_order("AAPL", 100, 1.5);
+    Order * replica = new_order("AAPL", 100, 1.5);
+    to->m_qty = 60;
+    to->m_active = false;
+
+    ObjectDelta delta = diff_objects(from, to);
+    assert(delta.changed_count() == 2);
+    string wire;
+    delta.encode(wire);
+
+    //只传变化的字段，在另一份副本上重放
+    apply_delta(replica, ObjectDelta::decode(wire.data(), wire.size()));
+    assert(replica->m_qty == 60 && !replica->m_active);
+    assert(diff_objects(replica, to).empty());
+
+    //bool的字节不是0/1时读成true
+    string flag = wire;
+    flag.back() = 2;
+    apply_delta(replica, ObjectDelta::decode(flag.data(), flag.size()));
+    assert(replica->m_active);
+
+    //schema hash对不上时抛异常(类名之后就是hash)
+    string stale = wire;
+    stale[1 + from->get_class_name().size()] ^= 1;
+    bool thrown = false;
+    try
+    {
+        ObjectDelta::decode(stale.data(), stale.size());
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    delete from;
+    delete to;
+    delete replica;
+    cout << "diff ok" << endl;
+}
+
+void test_column_store()
+{
+    ReflectedColumnStore<Order> store("Order");
+    Order * order = new_order("", 0, 0);
+    for (int i = 0; i < 1000; i++)
+    {
+        order->m_symbol = i % 2 == 0 ? "even" : "odd";
+        order->m_qty = i;
+        order->m_price = 0.5;
+        store.push_back(*order);
+    }
+    assert(store.size() == 1000);
+    assert((store.sum<int, long>("m_qty") == 499500));
+    assert(store.column<string>("m_symbol")[3] == "odd");
+    assert(store.filter<int>("m_qty", [](int qty) { return qty >= 990; }).size() == 10);
+
+    //按行取回对象
+    Order row;
+    store.load(42, row);
+    assert(row.m_qty == 42 && row.m_symbol == "even");
+
+    //类名和T对不上时抛异常
+    bool thrown = false;
+    try
+    {
+        ReflectedColumnStore<Order> wrong("Quote");
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    delete order;
+    cout << "column store ok" << endl;
+}
+
+void test_pool()
+{
+    ObjectBatch batch = factory()->create_class_bulk("Order", 16);
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        static_cast<Order *>(batch[i])->m_qty = (int)i;
+    }
+    ObjectHandle handle = factory()->create_class_pooled("Order");
+    static_cast<Order *>(handle.get())->m_symbol = "pooled";
+
+    //重新注册同一个类会换一个新池子，旧池子里的对象仍然有效，全部还回去后旧池子才释放
+    ClassRegister again("Order", createObjectOrder, placeObjectOrder, sizeof(Order), alignof(Order));
+    ObjectHandle fresh = factory()->create_class_pooled("Order");
+    assert(fresh->get_class_name() == "Order");
+    assert(static_cast<Order *>(handle.get())->m_symbol == "pooled");
+    assert(static_cast<Order *>(batch[15])->m_qty == 15);
+    handle.reset();
+    batch.reset();
+    cout << "pool ok" << endl;
+}
+
+void test_freeze()
+{
+    factory()->freeze();
+    assert(factory()->frozen());
+    //freeze之后查询走只读快照
+    Order * order = new_order("AAPL", 1, 1);
+    assert(order->get_field_count() == 4);
+    delete order;
+
+    //freeze之后仍然可以注册，发布一份新快照，已有的类信息不受影响
+    ClassRegister quote("Quote", createQuote, placeQuote, sizeof(Quote), alignof(Quote));
+    ClassRegister bid("Quote", "m_bid", "double", REGIST_FIELD_OFFSET(Quote, m_bid), sizeof(double), field_kind<double>());
+    Object * q = factory()->create_class("Quote");
+    q->set("m_bid", 9.5);
+    q->show();
+    assert(factory()->get_class_field_count("Quote") == 1);
+    assert(factory()->get_class_field_count("Order") == 4);
+    delete q;
+    cout << "freeze ok" << endl;
+}
+
+int main()
+{
+    test_field();
+    test_meta();
+    test_method();
+    test_serializer();
+    test_json();
+    test_diff();
+    test_column_store();
+    test_pool();
+    test_freeze();
+    //freeze之后的路径再跑一遍
+    test_field();
+    test_pool();
+    return 0;
+}